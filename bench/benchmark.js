@@ -0,0 +1,128 @@
+/**********************************************************************************
+ * CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+ *                    This project lets you to quickly prototype a REST API
+ *                    in a Node.js for a image processing service written in C++. 
+ * 
+ * Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+ * 
+ * More information:
+ *  - https://cloudcv.io
+ *  - http://computer-vision-talks.com
+ * 
+ **********************************************************************************/
+
+// Benchmarks native kernels of all registered algorithms and prints JSON report.
+//
+// Usage: node bench/benchmark.js [options]
+//   --algorithms houghLines,integralImage   Algorithms to run (default: all)
+//   --sizes 640x480,1920x1080               Synthetic image sizes
+//   --channels 1,3                          Channel counts of synthetic images
+//   --images a.jpg,b.png                    Image files (default: test/data/*)
+//   --iterations N                          Minimal number of timed runs per case
+//   --min-time MS                           Minimal timed duration per case
+//   --warmup N                              Untimed runs before measurement
+//   --out FILE                              Write report to file instead of stdout
+//   --baseline FILE                         Compare with earlier report and exit with
+//                                           code 1 if a case is slower than --threshold
+//   --threshold 0.1                         Allowed relative slowdown of median time
+//
+// Timing happens in C++ on a single thread, see src/framework/Benchmark.hpp.
+
+var fs   = require('fs');
+var os   = require('os');
+var path = require('path');
+
+var cloudcv = require('../cloudcv.js');
+var stats   = require('./stats.js');
+
+function benchmarkOptions(args) {
+  var dataDir = path.join(__dirname, '..', 'test', 'data');
+  var options = {};
+
+  if (args.algorithms)
+    options.algorithms = stats.list(args.algorithms);
+
+  if (args.sizes) {
+    options.sizes = stats.list(args.sizes).map(function(size) {
+      var wh = size.split('x');
+      return { width: parseInt(wh[0]), height: parseInt(wh[1]) };
+    });
+  }
+
+  if (args.channels)
+    options.channels = stats.list(args.channels).map(Number);
+
+  if (args.images !== undefined) {
+    options.images = stats.list(args.images);
+  } else {
+    options.images = fs.readdirSync(dataDir).map(function(file) { return path.join(dataDir, file); });
+  }
+
+  if (args.iterations)
+    options.iterations = Number(args.iterations);
+
+  if (args['min-time'])
+    options.minTimeMs = Number(args['min-time']);
+
+  if (args.warmup)
+    options.warmup = Number(args.warmup);
+
+  return options;
+}
+
+function caseKey(result) {
+  return [result.algorithm, path.basename(result.input), result.width + 'x' + result.height, result.channels].join(' ');
+}
+
+// Returns descriptions of cases that got slower than threshold compared to baseline
+function compare(report, baseline, threshold) {
+  var previous = {};
+  var regressions = [];
+
+  baseline.results.forEach(function(result) {
+    previous[caseKey(result)] = result;
+  });
+
+  report.results.forEach(function(result) {
+    var before = previous[caseKey(result)];
+    if (!before || before.error || result.error)
+      return;
+
+    var ratio = result.medianNs / before.medianNs;
+    console.error(caseKey(result) + ': ' + (ratio * 100 - 100).toFixed(1) + '%');
+
+    if (ratio > 1 + threshold)
+      regressions.push(caseKey(result) + ' is ' + ratio.toFixed(2) + 'x slower');
+  });
+
+  return regressions;
+}
+
+var args = stats.parseArguments(process.argv.slice(2));
+
+cloudcv.runBenchmark(benchmarkOptions(args), function(error, json) {
+  if (error) {
+    console.error(error);
+    process.exit(2);
+  }
+
+  var report = JSON.parse(json);
+  report.node = process.version;
+  report.cpu = os.cpus()[0].model;
+  report.date = new Date().toISOString();
+
+  var output = JSON.stringify(report, null, 2);
+
+  if (args.out)
+    fs.writeFileSync(args.out, output);
+  else
+    console.log(output);
+
+  if (args.baseline) {
+    var baseline = JSON.parse(fs.readFileSync(args.baseline));
+    var regressions = compare(report, baseline, args.threshold ? Number(args.threshold) : 0.1);
+
+    regressions.forEach(function(regression) { console.error('Regression: ' + regression); });
+    process.exit(regressions.length > 0 ? 1 : 0);
+  }
+});
@@ -0,0 +1,101 @@
+/**********************************************************************************
+ * CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+ *                    This project lets you to quickly prototype a REST API
+ *                    in a Node.js for a image processing service written in C++. 
+ * 
+ * Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+ * 
+ * More information:
+ *  - https://cloudcv.io
+ *  - http://computer-vision-talks.com
+ * 
+ **********************************************************************************/
+
+// Synthetic PNG frames for load tests. Pure JS, so the harness works offline 
+// and does not depend on anything but Node itself.
+
+var zlib = require('zlib');
+
+var CRC_TABLE = (function() {
+  var table = new Int32Array(256);
+
+  for (var n = 0; n < 256; n++) {
+    var c = n;
+    for (var k = 0; k < 8; k++)
+      c = (c & 1) ? (0xEDB88320 ^ (c >>> 1)) : (c >>> 1);
+    table[n] = c;
+  }
+
+  return table;
+})();
+
+function crc32(buffer) {
+  var crc = -1;
+  for (var i = 0; i < buffer.length; i++)
+    crc = CRC_TABLE[(crc ^ buffer[i]) & 0xFF] ^ (crc >>> 8);
+  return (crc ^ -1) >>> 0;
+}
+
+function chunk(type, data) {
+  var length = Buffer.alloc(4);
+  length.writeUInt32BE(data.length, 0);
+
+  var body = Buffer.concat([Buffer.from(type, 'ascii'), data]);
+
+  var crc = Buffer.alloc(4);
+  crc.writeUInt32BE(crc32(body), 0);
+
+  return Buffer.concat([length, body, crc]);
+}
+
+// Deterministic pseudo random generator, so the same seed gives the same frame
+function random(seed) {
+  var state = seed >>> 0 || 1;
+  return function() {
+    state ^= state << 13; state >>>= 0;
+    state ^= state >>> 17;
+    state ^= state << 5;  state >>>= 0;
+    return state / 4294967296;
+  };
+}
+
+// Returns PNG encoded frame with straight edges on a noisy gradient.
+// channels is 1 (grayscale) or 3 (RGB).
+function generateFrame(width, height, channels, seed) {
+  var rnd = random(seed);
+  var stride = width * channels + 1;
+  var pixels = Buffer.alloc(stride * height);
+
+  for (var y = 0; y < height; y++) {
+    pixels[y * stride] = 0; // No filter
+    for (var x = 0; x < width * channels; x++)
+      pixels[y * stride + 1 + x] = (x / channels * 128 / width + y * 64 / height + rnd() * 24) | 0;
+  }
+
+  // Horizontal, vertical and diagonal lines give line detectors something to find
+  for (var i = 0; i < 12; i++) {
+    var x0 = (rnd() * width) | 0, y0 = (rnd() * height) | 0;
+    var dx = [1, 0, 1, 1][i % 4], dy = [0, 1, 1, -1][i % 4];
+    var value = 160 + (rnd() * 95) | 0;
+
+    for (var x = x0, y = y0; x >= 0 && y >= 0 && x < width && y < height; x += dx, y += dy)
+      for (var c = 0; c < channels; c++)
+        pixels[y * stride + 1 + x * channels + c] = value;
+  }
+
+  var header = Buffer.alloc(13);
+  header.writeUInt32BE(width, 0);
+  header.writeUInt32BE(height, 4);
+  header[8] = 8;                        // Bit depth
+  header[9] = channels === 1 ? 0 : 2;   // Grayscale or RGB
+  header[10] = header[11] = header[12] = 0;
+
+  return Buffer.concat([
+    Buffer.from([0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A]),
+    chunk('IHDR', header),
+    chunk('IDAT', zlib.deflateSync(pixels)),
+    chunk('IEND', Buffer.alloc(0))
+  ]);
+}
+
+module.exports.generateFrame = generateFrame;
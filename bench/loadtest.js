@@ -0,0 +1,393 @@
+/**********************************************************************************
+ * CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+ *                    This project lets you to quickly prototype a REST API
+ *                    in a Node.js for a image processing service written in C++. 
+ * 
+ * Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+ * 
+ * More information:
+ *  - https://cloudcv.io
+ *  - http://computer-vision-talks.com
+ * 
+ **********************************************************************************/
+
+// Load generator for server.js. Starts the server locally (or uses --url), drives 
+// POST /api/<algorithm> with a mix of test/data images and generated frames and
+// prints JSON report with throughput, latency percentiles and a per second timeline
+// of server event loop lag and RSS. Works offline.
+//
+// Usage: node bench/loadtest.js [options]
+//   --url http://host:port       Use running server instead of starting one
+//   --port 3917                  Port of the locally started server
+//   --algorithms houghLines      Algorithms to call (default: all)
+//   --concurrency 8              Requests in flight (closed loop)
+//   --rate R                     Send R requests per second regardless of responses (open loop)
+//   --duration 30                Measured seconds
+//   --warmup 3                   Seconds before measurement
+//   --mix data=1,640x480x3=2     Weighted image mix: "data" are files in test/data,
+//                                WxHxC are generated frames of given size and channels
+//   --frames 8                   Distinct generated frames per size
+//   --params rho=1..4,threshold=50|100|150
+//                                Parameter distributions: integer range or choice.
+//                                "random" draws every numeric argument from its declared range.
+//   --out FILE                   Write report to file instead of stdout
+//   --verbose true               Pass server output through
+
+var fs           = require('fs');
+var path         = require('path');
+var http         = require('http');
+var url          = require('url');
+var childProcess = require('child_process');
+var frames       = require('./frames.js');
+var stats        = require('./stats.js');
+var cloudcv      = require('../cloudcv.js');
+
+// Returns array of { name, buffer, weight } described by --mix
+function loadImages(mix, framesPerSize) {
+  var dataDir = path.join(__dirname, '..', 'test', 'data');
+  var images = [];
+
+  stats.list(mix).forEach(function(item) {
+    var parts = item.split('=');
+    var weight = parts.length > 1 ? Number(parts[1]) : 1;
+
+    if (parts[0] === 'data') {
+      var files = fs.readdirSync(dataDir);
+      files.forEach(function(file) {
+        images.push({ name: file, buffer: fs.readFileSync(path.join(dataDir, file)), weight: weight / files.length });
+      });
+      return;
+    }
+
+    var size = parts[0].split('x').map(Number);
+    if (size.length !== 3 || !(size[0] > 0 && size[1] > 0) || (size[2] !== 1 && size[2] !== 3))
+      throw new Error('Expected WxHxC with 1 or 3 channels instead of ' + parts[0]);
+
+    // Distinct frames, so the server cannot answer from its image cache every time
+    for (var seed = 1; seed <= framesPerSize; seed++) {
+      images.push({ name: parts[0], buffer: frames.generateFrame(size[0], size[1], size[2], seed), weight: weight / framesPerSize });
+    }
+  });
+
+  return images;
+}
+
+function pickWeighted(items) {
+  var total = items.reduce(function(sum, item) { return sum + item.weight; }, 0);
+  var value = Math.random() * total;
+
+  for (var i = 0; i < items.length; i++) {
+    value -= items[i].weight;
+    if (value < 0)
+      return items[i];
+  }
+
+  return items[items.length - 1];
+}
+
+// Returns function that draws argument values for given algorithm
+function parameterGenerator(algorithm, spec) {
+  var info = cloudcv.getInfo(algorithm);
+  var args = Object.keys(info.inputArguments).map(function(key) { return info.inputArguments[key]; });
+  var generators = {};
+
+  args.forEach(function(arg) {
+    if (spec === 'random' && typeof arg.min === 'number') {
+      generators[arg.name] = function() { return arg.min + Math.floor(Math.random() * (arg.max - arg.min + 1)); };
+    }
+  });
+
+  if (spec && spec !== 'random') {
+    stats.list(spec).forEach(function(item) {
+      var parts = item.split('=');
+      var name = parts[0], values = parts[1];
+
+      if (values.indexOf('..') > 0) {
+        var range = values.split('..').map(Number);
+        generators[name] = function() { return range[0] + Math.floor(Math.random() * (range[1] - range[0] + 1)); };
+      } else {
+        var choices = values.split('|').map(Number);
+        generators[name] = function() { return choices[Math.floor(Math.random() * choices.length)]; };
+      }
+    });
+  }
+
+  var imageArguments = args
+    .filter(function(arg) { return arg.type.indexOf('ImageView') >= 0; })
+    .map(function(arg) { return arg.name; });
+
+  // Distributions of arguments this algorithm does not have are ignored
+  var names = Object.keys(generators).filter(function(name) {
+    return args.some(function(arg) { return arg.name === name; });
+  });
+
+  return {
+    images: imageArguments,
+    draw: function() {
+      var values = {};
+      names.forEach(function(name) { values[name] = generators[name](); });
+      return values;
+    }
+  };
+}
+
+function multipartBody(boundary, fields, files) {
+  var parts = [];
+
+  Object.keys(fields).forEach(function(name) {
+    parts.push(Buffer.from('--' + boundary + '\r\nContent-Disposition: form-data; name="' + name + '"\r\n\r\n' + fields[name] + '\r\n'));
+  });
+
+  files.forEach(function(file) {
+    parts.push(Buffer.from('--' + boundary + '\r\nContent-Disposition: form-data; name="' + file.field + '"; filename="' + file.name + '"\r\n' +
+                           'Content-Type: application/octet-stream\r\n\r\n'));
+    parts.push(file.buffer);
+    parts.push(Buffer.from('\r\n'));
+  });
+
+  parts.push(Buffer.from('--' + boundary + '--\r\n'));
+  return Buffer.concat(parts);
+}
+
+function waitForServer(target, timeoutMs, callback) {
+  var started = Date.now();
+
+  (function poll() {
+    http.get(target + '/swagger.json', function(res) {
+      res.resume();
+      callback(null);
+    }).on('error', function(error) {
+      if (Date.now() - started > timeoutMs)
+        return callback(error);
+
+      setTimeout(poll, 200);
+    });
+  })();
+}
+
+function startServer(port, verbose) {
+  var server = childProcess.fork(path.join(__dirname, '..', 'server.js'), [], {
+    cwd:      path.join(__dirname, '..'),
+    env:      Object.assign({}, process.env, { PORT: String(port) }),
+    execArgv: process.execArgv.concat(['-r', path.join(__dirname, 'probe.js')]),
+    silent:   !verbose
+  });
+
+  if (!verbose) {
+    server.stdout.resume();
+    server.stderr.resume();
+  }
+
+  return server;
+}
+
+function run(args) {
+  var concurrency = Number(args.concurrency || 8);
+  var durationMs  = Number(args.duration || 30) * 1000;
+  var warmupMs    = Number(args.warmup || 3) * 1000;
+  var rate        = args.rate ? Number(args.rate) : 0;
+  var port        = Number(args.port || 3917);
+  var target      = args.url || ('http://127.0.0.1:' + port);
+
+  var algorithms = args.algorithms ? stats.list(args.algorithms) : cloudcv.getAlgorithms();
+  var images     = loadImages(args.mix || 'data=1,640x480x3=1,1280x720x1=1', Number(args.frames || 8));
+  var generators = {};
+
+  algorithms.forEach(function(algorithm) {
+    generators[algorithm] = parameterGenerator(algorithm, args.params);
+  });
+
+  var parsedTarget = url.parse(target);
+  var agent = new http.Agent({ keepAlive: true, maxSockets: rate > 0 ? Infinity : concurrency });
+  var boundary = 'cloudcv-loadtest-boundary';
+
+  var server = args.url ? null : startServer(port, args.verbose === 'true');
+  var probes = [];
+
+  if (server) {
+    server.on('message', function(message) {
+      if (message && message.probe)
+        probes.push(message);
+    });
+  }
+
+  var samples = [];
+  var inFlight = 0;
+  var measureFrom, measureTo, stopAt;
+
+  function sendRequest(scheduledAt, done) {
+    var algorithm = algorithms[Math.floor(Math.random() * algorithms.length)];
+    var generator = generators[algorithm];
+    var image = pickWeighted(images);
+
+    var files = generator.images.map(function(field) { return { field: field, name: image.name, buffer: image.buffer }; });
+    var body = multipartBody(boundary, generator.draw(), files);
+
+    inFlight++;
+
+    var req = http.request({
+      hostname: parsedTarget.hostname,
+      port:     parsedTarget.port,
+      path:     '/api/' + algorithm,
+      method:   'POST',
+      agent:    agent,
+      headers:  {
+        'Content-Type':   'multipart/form-data; boundary=' + boundary,
+        'Content-Length': body.length
+      }
+    }, function(res) {
+      res.resume();
+      res.on('end', function() {
+        finish(res.statusCode);
+      });
+    });
+
+    req.on('error', function() { finish(0); });
+    req.end(body);
+
+    var finished = false;
+    function finish(status) {
+      if (finished)
+        return;
+
+      finished = true;
+      inFlight--;
+
+      var now = Date.now();
+      if (scheduledAt >= measureFrom && scheduledAt < measureTo)
+        samples.push({ time: now, algorithm: algorithm, image: image.name, status: status, latencyMs: now - scheduledAt });
+
+      if (done)
+        done();
+    }
+  }
+
+  function closedLoop() {
+    if (Date.now() < stopAt)
+      sendRequest(Date.now(), closedLoop);
+  }
+
+  function openLoop() {
+    var interval = 1000 / rate;
+    var next = Date.now();
+
+    (function tick() {
+      var now = Date.now();
+
+      // Latency is counted from the scheduled time, so a stalled server is not hidden
+      while (next <= now && next < stopAt) {
+        sendRequest(next, null);
+        next += interval;
+      }
+
+      if (next < stopAt)
+        setTimeout(tick, Math.max(0, next - Date.now()));
+    })();
+  }
+
+  function report() {
+    var measuredMs = measureTo - measureFrom;
+    var errors = {};
+
+    samples.forEach(function(sample) {
+      if (sample.status !== 200)
+        errors[sample.status] = (errors[sample.status] || 0) + 1;
+    });
+
+    var ok = samples.filter(function(sample) { return sample.status === 200; });
+
+    var perAlgorithm = {};
+    algorithms.forEach(function(algorithm) {
+      perAlgorithm[algorithm] = stats.latencySummary(ok.filter(function(s) { return s.algorithm === algorithm; }).map(function(s) { return s.latencyMs; }));
+    });
+
+    var perImage = {};
+    images.forEach(function(image) {
+      if (!perImage[image.name])
+        perImage[image.name] = stats.latencySummary(ok.filter(function(s) { return s.image === image.name; }).map(function(s) { return s.latencyMs; }));
+    });
+
+    var timeline = [];
+    for (var second = 0; second * 1000 < measuredMs; second++) {
+      var from = measureFrom + second * 1000, to = from + 1000;
+
+      var completed = samples.filter(function(s) { return s.time >= from && s.time < to; });
+      var window = probes.filter(function(p) { return p.time >= from && p.time < to; });
+
+      var latency = stats.latencySummary(completed.filter(function(s) { return s.status === 200; }).map(function(s) { return s.latencyMs; }));
+
+      timeline.push({
+        second:    second,
+        requests:  completed.length,
+        errors:    completed.length - latency.count,
+        p50:       latency.p50,
+        p99:       latency.p99,
+        lagMaxMs:  window.reduce(function(max, p) { return Math.max(max, p.lagMs); }, 0),
+        rssMB:     window.length ? window[window.length - 1].rss / 1048576 : null
+      });
+    }
+
+    var measuredProbes = probes.filter(function(p) { return p.time >= measureFrom && p.time < measureTo; });
+    var lags = measuredProbes.map(function(p) { return p.lagMs; }).sort(function(a, b) { return a - b; });
+
+    return {
+      target:       target,
+      algorithms:   algorithms,
+      concurrency:  rate > 0 ? null : concurrency,
+      rate:         rate > 0 ? rate : null,
+      durationS:    measuredMs / 1000,
+      mix:          args.mix || 'data=1,640x480x3=1,1280x720x1=1',
+      params:       args.params || null,
+      requests:     samples.length,
+      errors:       errors,
+      throughput:   ok.length * 1000 / measuredMs,
+      latencyMs:    stats.latencySummary(ok.map(function(s) { return s.latencyMs; })),
+      perAlgorithm: perAlgorithm,
+      perImage:     perImage,
+      server:       server ? {
+        eventLoopLagMs: { p50: stats.percentile(lags, 0.5), p99: stats.percentile(lags, 0.99), max: lags.length ? lags[lags.length - 1] : 0 },
+        peakRssMB:      measuredProbes.reduce(function(max, p) { return Math.max(max, p.rss); }, 0) / 1048576
+      } : null,
+      timeline:     timeline
+    };
+  }
+
+  waitForServer(target, 30000, function(error) {
+    if (error) {
+      console.error('Server did not start: ' + error.message);
+      if (server) server.kill();
+      process.exit(2);
+    }
+
+    var started = Date.now();
+    measureFrom = started + warmupMs;
+    measureTo   = measureFrom + durationMs;
+    stopAt      = measureTo;
+
+    console.error('Running ' + (rate > 0 ? rate + ' req/s' : concurrency + ' concurrent requests') + ' against ' + target + ' for ' + (warmupMs + durationMs) / 1000 + 's');
+
+    if (rate > 0) {
+      openLoop();
+    } else {
+      for (var i = 0; i < concurrency; i++)
+        closedLoop();
+    }
+
+    (function waitForCompletion() {
+      if (Date.now() < stopAt || inFlight > 0)
+        return setTimeout(waitForCompletion, 100);
+
+      var output = JSON.stringify(report(), null, 2);
+
+      if (args.out)
+        fs.writeFileSync(args.out, output);
+      else
+        console.log(output);
+
+      agent.destroy();
+      if (server) server.kill();
+    })();
+  });
+}
+
+run(stats.parseArguments(process.argv.slice(2)));
@@ -0,0 +1,41 @@
+/**********************************************************************************
+ * CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+ *                    This project lets you to quickly prototype a REST API
+ *                    in a Node.js for a image processing service written in C++. 
+ * 
+ * Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+ * 
+ * More information:
+ *  - https://cloudcv.io
+ *  - http://computer-vision-talks.com
+ * 
+ **********************************************************************************/
+
+// Preloaded into the server by bench/loadtest.js (node -r bench/probe.js server.js).
+// Samples event loop lag and memory of the server and sends them to the load 
+// generator over the IPC channel of child_process.fork.
+
+var INTERVAL_MS = 100;
+
+if (process.send) {
+  var expected = Date.now() + INTERVAL_MS;
+
+  var timer = setInterval(function() {
+    var now = Date.now();
+    var memory = process.memoryUsage();
+
+    process.send({
+      probe:     true,
+      time:      now,
+      lagMs:     Math.max(0, now - expected),
+      rss:       memory.rss,
+      heapUsed:  memory.heapUsed,
+      external:  memory.external || 0
+    });
+
+    expected = now + INTERVAL_MS;
+  }, INTERVAL_MS);
+
+  // Do not keep the server alive on our own
+  timer.unref();
+}
@@ -0,0 +1,247 @@
+/**********************************************************************************
+ * CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+ *                    This project lets you to quickly prototype a REST API
+ *                    in a Node.js for a image processing service written in C++. 
+ * 
+ * Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+ * 
+ * More information:
+ *  - https://cloudcv.io
+ *  - http://computer-vision-talks.com
+ * 
+ **********************************************************************************/
+
+// Replays a traffic log recorded with cloudcv.startRecording() through the addon
+// and prints JSON report with latency per algorithm.
+//
+// Usage: node bench/replay.js --log traffic.log [options]
+//   --speed 1              Pacing relative to the recording: 1 is original, 10 is ten
+//                          times faster, 0 sends as fast as --concurrency allows
+//   --concurrency 16       Requests in flight when --speed is 0
+//   --loop 1               Number of passes over the log
+//   --algorithms a,b       Replay only requests of these algorithms
+//   --out FILE             Write report to file instead of stdout
+//   --baseline FILE        Compare with earlier report and exit with code 1 if p50 or 
+//                          p99 of an algorithm is slower than --threshold (0.1)
+//
+// Images whose bytes were not sampled into the log are replaced with the stored 
+// image closest in encoded size; the report counts such substitutions.
+
+var fs         = require('fs');
+var trafficLog = require('./trafficLog.js');
+var stats      = require('./stats.js');
+var cloudcv    = require('../cloudcv.js');
+
+// Turns recorded values into arguments of the addon. Returns null if an image cannot be provided.
+function argumentResolver(traffic) {
+  var stored = Object.keys(traffic.images).map(function(hash) { return traffic.images[hash]; });
+  var result = { substituted: 0 };
+
+  function closestImage(length) {
+    var best = null;
+
+    stored.forEach(function(image) {
+      if (best === null || Math.abs(image.length - length) < Math.abs(best.length - length))
+        best = image;
+    });
+
+    return best;
+  }
+
+  result.resolve = function(recorded) {
+    var args = {};
+
+    for (var name in recorded) {
+      var value = recorded[name];
+
+      if (value === null || typeof value !== 'object') {
+        args[name] = value;
+      }
+      else if (value.hash !== undefined) {
+        args[name] = traffic.images[value.hash];
+
+        if (!args[name]) {
+          args[name] = closestImage(value.length);
+          result.substituted++;
+        }
+      }
+      else if (fs.existsSync(value.path)) {
+        args[name] = value.path;
+      }
+      else {
+        args[name] = closestImage(0);
+        result.substituted++;
+      }
+
+      if (args[name] === null)
+        return null;
+    }
+
+    return args;
+  };
+
+  return result;
+}
+
+// Returns descriptions of algorithms that got slower than threshold compared to baseline
+function compare(report, baseline, threshold) {
+  var regressions = [];
+
+  Object.keys(report.perAlgorithm).forEach(function(algorithm) {
+    var after = report.perAlgorithm[algorithm];
+    var before = baseline.perAlgorithm[algorithm];
+
+    if (!before || before.count === 0 || after.count === 0)
+      return;
+
+    ['p50', 'p99'].forEach(function(p) {
+      var ratio = after[p] / Math.max(before[p], 0.001);
+      console.error(algorithm + ' ' + p + ': ' + (ratio * 100 - 100).toFixed(1) + '%');
+
+      if (ratio > 1 + threshold)
+        regressions.push(algorithm + ' ' + p + ' is ' + ratio.toFixed(2) + 'x slower');
+    });
+  });
+
+  return regressions;
+}
+
+function run(args) {
+  if (!args.log)
+    throw new Error('--log is required');
+
+  var speed       = args.speed !== undefined ? Number(args.speed) : 1;
+  var concurrency = Number(args.concurrency || 16);
+  var loops       = Number(args.loop || 1);
+  var algorithms  = args.algorithms ? stats.list(args.algorithms) : null;
+
+  var traffic  = trafficLog.read(args.log);
+  var resolver = argumentResolver(traffic);
+
+  var requests = traffic.requests.filter(function(request) {
+    return cloudcv[request.algorithm] && (!algorithms || algorithms.indexOf(request.algorithm) >= 0);
+  });
+
+  if (requests.length === 0)
+    throw new Error('No requests to replay in ' + args.log);
+
+  var recordedMs = requests[requests.length - 1].time - requests[0].time;
+  var samples = [];
+  var skipped = 0;
+  var errors = {};
+  var next = 0, inFlight = 0;
+  var total = requests.length * loops;
+  var started = Date.now();
+
+  console.error('Replaying ' + total + ' requests ' + (speed > 0 ? 'at ' + speed + 'x speed' : 'with ' + concurrency + ' in flight'));
+
+  function send(index, scheduledAt, done) {
+    var request = requests[index % requests.length];
+    var requestArgs = resolver.resolve(request.args);
+
+    if (requestArgs === null) {
+      skipped++;
+      return done && setImmediate(done);
+    }
+
+    inFlight++;
+
+    cloudcv[request.algorithm](requestArgs, function(error) {
+      inFlight--;
+
+      var now = Date.now();
+      if (error)
+        errors[error.code || error.message] = (errors[error.code || error.message] || 0) + 1;
+      else
+        samples.push({ algorithm: request.algorithm, latencyMs: now - scheduledAt });
+
+      if (done)
+        done();
+      else
+        finishIfDone();
+    });
+  }
+
+  function sendNext() {
+    if (next < total)
+      send(next++, Date.now(), sendNext);
+    else
+      finishIfDone();
+  }
+
+  // Latency is counted from the scheduled time, so a stalled addon is not hidden
+  function pace() {
+    var now = Date.now();
+
+    while (next < total) {
+      var pass = Math.floor(next / requests.length);
+      var offset = requests[next % requests.length].time - requests[0].time + pass * (recordedMs + 1);
+      var scheduledAt = started + offset / speed;
+
+      if (scheduledAt > now)
+        return setTimeout(pace, scheduledAt - now);
+
+      send(next++, scheduledAt, null);
+    }
+
+    finishIfDone();
+  }
+
+  var finished = false;
+  function finishIfDone() {
+    if (finished || next < total || inFlight > 0)
+      return;
+
+    finished = true;
+
+    var elapsedMs = Date.now() - started;
+    var perAlgorithm = {};
+
+    samples.forEach(function(sample) {
+      (perAlgorithm[sample.algorithm] = perAlgorithm[sample.algorithm] || []).push(sample.latencyMs);
+    });
+
+    Object.keys(perAlgorithm).forEach(function(algorithm) {
+      perAlgorithm[algorithm] = stats.latencySummary(perAlgorithm[algorithm]);
+    });
+
+    var report = {
+      log:          args.log,
+      speed:        speed,
+      concurrency:  speed > 0 ? null : concurrency,
+      requests:     total,
+      completed:    samples.length,
+      skipped:      skipped,
+      substituted:  resolver.substituted,
+      errors:       errors,
+      recordedS:    recordedMs / 1000,
+      elapsedS:     elapsedMs / 1000,
+      throughput:   samples.length * 1000 / elapsedMs,
+      latencyMs:    stats.latencySummary(samples.map(function(s) { return s.latencyMs; })),
+      perAlgorithm: perAlgorithm
+    };
+
+    var output = JSON.stringify(report, null, 2);
+
+    if (args.out)
+      fs.writeFileSync(args.out, output);
+    else
+      console.log(output);
+
+    if (args.baseline) {
+      var regressions = compare(report, JSON.parse(fs.readFileSync(args.baseline)), args.threshold ? Number(args.threshold) : 0.1);
+
+      regressions.forEach(function(regression) { console.error('Regression: ' + regression); });
+      process.exit(regressions.length > 0 ? 1 : 0);
+    }
+  }
+
+  if (speed > 0) {
+    pace();
+  } else {
+    for (var i = 0; i < concurrency; i++)
+      sendNext();
+  }
+}
+
+run(stats.parseArguments(process.argv.slice(2)));
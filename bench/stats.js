@@ -0,0 +1,59 @@
+/**********************************************************************************
+ * CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+ *                    This project lets you to quickly prototype a REST API
+ *                    in a Node.js for a image processing service written in C++. 
+ * 
+ * Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+ * 
+ * More information:
+ *  - https://cloudcv.io
+ *  - http://computer-vision-talks.com
+ * 
+ **********************************************************************************/
+
+// Helpers shared by the bench tools: command line parsing and latency summaries
+
+// Parses "--name value" pairs into { name: value }
+function parseArguments(argv) {
+  var args = {};
+
+  for (var i = 0; i < argv.length; i++) {
+    if (argv[i].indexOf('--') !== 0 || i + 1 >= argv.length)
+      throw new Error('Unexpected argument ' + argv[i]);
+
+    args[argv[i].substring(2)] = argv[++i];
+  }
+
+  return args;
+}
+
+function list(value) {
+  return value.split(',').filter(function(item) { return item.length > 0; });
+}
+
+function percentile(sorted, p) {
+  if (sorted.length === 0)
+    return 0;
+
+  return sorted[Math.min(sorted.length - 1, Math.floor(p * sorted.length))];
+}
+
+function latencySummary(latencies) {
+  var sorted = latencies.slice().sort(function(a, b) { return a - b; });
+  var total = sorted.reduce(function(sum, value) { return sum + value; }, 0);
+
+  return {
+    count: sorted.length,
+    mean:  sorted.length ? total / sorted.length : 0,
+    p50:   percentile(sorted, 0.50),
+    p95:   percentile(sorted, 0.95),
+    p99:   percentile(sorted, 0.99),
+    p999:  percentile(sorted, 0.999),
+    max:   sorted.length ? sorted[sorted.length - 1] : 0
+  };
+}
+
+module.exports.parseArguments = parseArguments;
+module.exports.list           = list;
+module.exports.percentile     = percentile;
+module.exports.latencySummary = latencySummary;
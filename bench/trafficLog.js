@@ -0,0 +1,105 @@
+/**********************************************************************************
+ * CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+ *                    This project lets you to quickly prototype a REST API
+ *                    in a Node.js for a image processing service written in C++. 
+ * 
+ * Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+ * 
+ * More information:
+ *  - https://cloudcv.io
+ *  - http://computer-vision-talks.com
+ * 
+ **********************************************************************************/
+
+// Reader of traffic logs written by cloudcv.startRecording(), 
+// see src/framework/TrafficRecorder.hpp for the layout.
+
+var fs = require('fs');
+
+var MAGIC = 'CCVTRAF1';
+
+var IMAGE_RECORD   = 1;
+var REQUEST_RECORD = 2;
+
+var NUMBER_VALUE     = 1;
+var STRING_VALUE     = 2;
+var IMAGE_VALUE      = 3;
+var IMAGE_FILE_VALUE = 4;
+
+// Returns { images: { hash: Buffer }, requests: [ { time, algorithm, args } ] }.
+// Image arguments are { hash, length } for buffers and { path } for files; 
+// hashes are hex strings because they do not fit into JS numbers.
+function read(path) {
+  var data = fs.readFileSync(path);
+  var offset = 0;
+
+  if (data.toString('ascii', 0, MAGIC.length) !== MAGIC)
+    throw new Error(path + ' is not a traffic log');
+
+  offset = MAGIC.length;
+
+  function u8()  { var v = data.readUInt8(offset); offset += 1; return v; }
+  function u32() { var v = data.readUInt32LE(offset); offset += 4; return v; }
+  function f64() { var v = data.readDoubleLE(offset); offset += 8; return v; }
+  function u64() {
+    var low = data.readUInt32LE(offset), high = data.readUInt32LE(offset + 4);
+    offset += 8;
+    return ('00000000' + high.toString(16)).slice(-8) + ('00000000' + low.toString(16)).slice(-8);
+  }
+  function bytes(length) {
+    if (offset + length > data.length)
+      throw new RangeError('Truncated record');
+
+    var v = data.slice(offset, offset + length);
+    offset += length;
+    return v;
+  }
+  function str() { return bytes(u32()).toString('utf8'); }
+
+  var log = { images: {}, requests: [] };
+
+  // A log of a crashed process may end with a partial record
+  try {
+    while (offset < data.length) {
+      var type = u8();
+
+      if (type === IMAGE_RECORD) {
+        var hash = u64();
+        log.images[hash] = bytes(u32());
+      }
+      else if (type === REQUEST_RECORD) {
+        var request = { time: f64(), algorithm: str(), args: {} };
+        var count = u8();
+
+        for (var i = 0; i < count; i++) {
+          var name = str();
+          var kind = u8();
+
+          if (kind === NUMBER_VALUE)
+            request.args[name] = f64();
+          else if (kind === STRING_VALUE)
+            request.args[name] = str();
+          else if (kind === IMAGE_VALUE)
+            request.args[name] = { hash: u64(), length: u32() };
+          else if (kind === IMAGE_FILE_VALUE)
+            request.args[name] = { path: str() };
+          else
+            throw new Error('Unknown value kind ' + kind);
+        }
+
+        log.requests.push(request);
+      }
+      else {
+        throw new Error('Unknown record type ' + type);
+      }
+    }
+  }
+  catch (e) {
+    if (!(e instanceof RangeError))
+      throw e;
+  }
+
+  return log;
+}
+
+module.exports.read = read;
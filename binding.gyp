@@ -14,23 +14,65 @@
                 "src/cloudcv.cpp", 
 
                 "src/framework/Logger.hpp",                
+                "src/framework/Tracer.hpp",
+                "src/framework/Tracer.cpp",
                 "src/framework/ScopedTimer.hpp",                
 
                 "src/framework/marshal/marshal.hpp",
                 "src/framework/marshal/opencv.hpp",                
+                "src/framework/marshal/typedarray.hpp",
 
                 "src/framework/ImageView.hpp",                
                 "src/framework/ImageView.cpp",
 
+                "src/framework/ImageHeader.hpp",                
+                "src/framework/ImageHeader.cpp",
+
+                "src/framework/ImageCache.hpp",                
+                "src/framework/ImageCache.cpp",
+
+                "src/framework/PooledMatAllocator.hpp",                
+                "src/framework/PooledMatAllocator.cpp",
+
+                "src/framework/NativeMemory.hpp",
+                "src/framework/NativeMemory.cpp",
+
+                "src/framework/ContentHash.hpp",                
+                "src/framework/ContentHash.cpp",
+
+                "src/framework/CancellationToken.hpp",                
+                "src/framework/CancellationToken.cpp",
+
                 "src/framework/Job.hpp",                
                 "src/framework/Job.cpp",
 
+                "src/framework/ThreadPool.hpp",                
+                "src/framework/ThreadPool.cpp",
+
                 "src/framework/Algorithm.hpp",
                 "src/framework/Algorithm.cpp",
 
+                "src/framework/Pipeline.hpp",
+                "src/framework/Pipeline.cpp",
+
                 "src/framework/AlgorithmInfo.hpp",
                 "src/framework/AlgorithmInfo.cpp",
 
+                "src/framework/AlgorithmStats.hpp",
+                "src/framework/AlgorithmStats.cpp",
+
+                "src/framework/RequestTimings.hpp",
+                "src/framework/RequestTimings.cpp",
+
+                "src/framework/TrafficRecorder.hpp",
+                "src/framework/TrafficRecorder.cpp",
+
+                "src/framework/Metrics.hpp",
+                "src/framework/Metrics.cpp",
+
+                "src/framework/Benchmark.hpp",
+                "src/framework/Benchmark.cpp",
+
                 "src/framework/Argument.hpp",
                 "src/framework/Argument.cpp",
 
@@ -29,10 +29,87 @@ var algorithms = nativeModule.getAlgorithms();
 module.exports.getInfo       = nativeModule.getInfo;
 module.exports.getAlgorithms = nativeModule.getAlgorithms;
 
+module.exports.getImageCacheStats  = nativeModule.getImageCacheStats;
+module.exports.setImageCacheBudget = nativeModule.setImageCacheBudget;
+module.exports.clearImageCache     = nativeModule.clearImageCache;
+
+module.exports.getMatAllocatorStats = nativeModule.getMatAllocatorStats;
+module.exports.setMatAllocatorLimit = nativeModule.setMatAllocatorLimit;
+module.exports.getMemoryStats       = nativeModule.getMemoryStats;
+module.exports.getMetrics           = nativeModule.getMetrics;
+
+module.exports.configureThreadPool = nativeModule.configureThreadPool;
+module.exports.getQueueStats       = nativeModule.getQueueStats;
+
+module.exports.getStats            = nativeModule.getStats;
+module.exports.resetStats          = nativeModule.resetStats;
+
+module.exports.startTracing        = nativeModule.startTracing;
+module.exports.stopTracing         = nativeModule.stopTracing;
+module.exports.dumpTrace           = nativeModule.dumpTrace;
+
+// captureTrace(durationMs, callback)
+// Traces the addon for durationMs and passes the Chrome trace JSON string to callback.
+module.exports.captureTrace = function(durationMs, callback) {
+  nativeModule.startTracing();
+
+  setTimeout(function() {
+    nativeModule.stopTracing();
+    callback(null, nativeModule.dumpTrace());
+  }, durationMs);
+};
+
+// startRecording(path, [options]) logs processFunction requests for bench/replay.js.
+// Options: imageSampleRate (fraction of distinct images stored, 0.1), maxBytes (1GB).
+module.exports.startRecording      = nativeModule.startRecording;
+module.exports.stopRecording       = nativeModule.stopRecording;
+module.exports.getRecorderStats    = nativeModule.getRecorderStats;
+
+// runBenchmark([options], callback)
+// Times kernels of all algorithms on synthetic and given images, callback receives JSON report.
+// See bench/benchmark.js for options.
+module.exports.runBenchmark = function(options, callback) {
+  if (typeof options === 'function') {
+    callback = options;
+    options = {};
+  }
+
+  nativeModule.runBenchmark(options, callback);
+};
+
+module.exports.CancellationToken   = nativeModule.CancellationToken;
+
+// processBatch(algorithmName, [args...], [options], callback)
+// Callback receives an array of {error, result} in the order of items.
+module.exports.processBatch = function(algName, items, options, callback) {
+  if (typeof options === 'function') {
+    callback = options;
+    options = {};
+  }
+
+  nativeModule.processBatch(algName, items, options, callback);
+};
+
+// processPipeline(spec, [options], callback)
+// Runs several algorithms over shared inputs in one job, see src/framework/Pipeline.hpp
+module.exports.processPipeline = function(spec, options, callback) {
+  if (typeof options === 'function') {
+    callback = options;
+    options = {};
+  }
+
+  nativeModule.processPipeline(spec, options, callback);
+};
+
 function registerAlgorithm(algName, index, array) {
-  console.log('a[' + index + '] = ' + algName);
+  module.exports[algName] = function(args, options, callback) { 
+    if (typeof options === 'function') {
+      callback = options;
+      options = {};
+    }
 
-  module.exports[algName] = function(args, callback) { nativeModule.processFunction(algName, args, callback); };
+    nativeModule.processFunction(algName, args, options, callback); 
+  };
 } 
 
 algorithms.forEach(registerAlgorithm);
\ No newline at end of file
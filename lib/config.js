@@ -13,6 +13,11 @@
 
 var config = {
     maxFileSize: 4 * 1048576, // 4 Megabyte should be enough
+    requestTimeout: 30000,    // Jobs still queued or running after 30 seconds are abandoned
+    traceEndpoint: false,     // Expose GET /debug/trace?seconds=N for capturing native traces
+    metricsEndpoint: true,    // Expose GET /metrics in Prometheus text format
+    recordTraffic: process.env.CLOUDCV_RECORD || null, // Path of traffic log for bench/replay.js, off by default
+    recordImageSampleRate: 0.1,                        // Fraction of distinct images whose bytes are recorded
 };
 
 module.exports = config;
@@ -48,6 +48,16 @@ app.set('views', __dirname + '/views');
 app.set('view engine', 'jade');
 app.set('view options', { pretty: true, layout: false });
 
+// Native image outputs and packed vectors are returned as typed arrays. 
+// Serialize them as plain JSON arrays instead of index-keyed objects.
+app.set('json replacer', function (key, value) {
+    var original = this[key];
+    if (original && ArrayBuffer.isView(original)) {
+        return Array.prototype.slice.call(original);
+    }
+    return value;
+});
+
 //app.use(json); 
 app.use(methodOverride());
 app.use(multer(multerOptions));
@@ -66,6 +76,26 @@ for (var i = algs.length - 1; i >= 0; i--)
     console.log(info.name)
 };
 
+// typeid() names of arithmetic types (Itanium ABI and MSVC)
+var numericTypes = ['b', 'c', 'a', 'h', 's', 't', 'i', 'j', 'l', 'm', 'x', 'y', 'f', 'd', 'e',
+                    'bool', 'char', 'signed char', 'unsigned char', 'short', 'unsigned short',
+                    'int', 'unsigned int', 'long', 'unsigned long', '__int64', 'unsigned __int64',
+                    'float', 'double', 'long double'];
+
+// Names of scalar arguments that may be set from form fields. Anything else,
+// images in particular, must never be bound from a client supplied string.
+function numericArguments(info) {
+  var names = {};
+
+  Object.keys(info.inputArguments).forEach(function(key) {
+    var arg = info.inputArguments[key];
+    if (typeof arg.min === 'number' || numericTypes.indexOf(arg.type) >= 0)
+      names[arg.name] = true;
+  });
+
+  return names;
+}
+
 
 
 
@@ -74,11 +104,58 @@ app.get('/', function (req, res) { res.render('index'); });
 app.get('/docs', function (req, res) { res.render('docs', { api: api_docs}); });
 app.get('/docs/:algorithmName', function (req, res) { res.render('docs', { api: api_docs, currentAlgorithm: req.params.algorithmName}); });
 
+// Native trace for chrome://tracing, e.g. GET /debug/trace?seconds=5
+if (config.traceEndpoint) {
+  app.get('/debug/trace', function (req, res) {
+    var seconds = Math.min(60, Math.max(1, parseFloat(req.query.seconds) || 5));
+
+    cv.captureTrace(seconds * 1000, function(error, trace) {
+      res.set('Content-Type', 'application/json');
+      res.set('Content-Disposition', 'attachment; filename="cloudcv-trace.json"');
+      res.send(trace);
+    });
+  });
+}
+
+// Native counters and process memory for Prometheus
+if (config.metricsEndpoint) {
+  app.get('/metrics', function (req, res) {
+    var memory = process.memoryUsage();
+
+    var text = cv.getMetrics() +
+      '# HELP process_resident_memory_bytes Resident memory of the server process\n' +
+      '# TYPE process_resident_memory_bytes gauge\n' +
+      'process_resident_memory_bytes ' + memory.rss + '\n' +
+      '# HELP nodejs_heap_used_bytes Used V8 heap\n' +
+      '# TYPE nodejs_heap_used_bytes gauge\n' +
+      'nodejs_heap_used_bytes ' + memory.heapUsed + '\n';
+
+    res.set('Content-Type', 'text/plain; version=0.0.4');
+    res.send(text);
+  });
+}
+
+// Opt-in log of the request mix for bench/replay.js
+if (config.recordTraffic) {
+  cv.startRecording(config.recordTraffic, { imageSampleRate: config.recordImageSampleRate });
+  logger.info("Recording traffic to " + config.recordTraffic);
+
+  // Orchestrators stop the server with SIGTERM, flush the log for both signals
+  ['SIGINT', 'SIGTERM'].forEach(function(signal) {
+    process.on(signal, function() {
+      cv.stopRecording();
+      process.exit(0);
+    });
+  });
+}
+
 // Specifications:
 app.get('/swagger.json',  function (req, res) { res.json(swagger.getSpec(algs)); });
 
 // Bind handlers:
 function createHandler(method) {
+  var formArguments = numericArguments(cv.getInfo(method));
+
   return function(req, res) {
     console.log('Called handler for ' + method);
     console.log(util.inspect(req.body));
@@ -96,17 +173,54 @@ function createHandler(method) {
       inArgs[key] = req.files[key].buffer;
     });
 
-    /*
-    console.log('Arguments:', util.inspect(inArgs));
-    Object.keys(req.body).forEach(function(key) {
-      console.log(key +" is " + req.body[key] )
-      inArgs[key] = req.body[key];
+    // Form fields carry numeric arguments only; unknown fields are ignored
+    var badField = null;
+    Object.keys(req.body || {}).forEach(function(key) {
+      if (!formArguments.hasOwnProperty(key))
+        return;
+
+      var value = req.body[key];
+      if (typeof value === 'string' && validator.isFloat(value))
+        inArgs[key] = parseFloat(value);
+      else
+        badField = key;
     });
-    */
+
+    if (badField) {
+      res.status(400).send({ message: 'Argument "' + badField + '" must be a number' });
+      return;
+    }
     
+    // ?packed=true returns vector outputs as flat arrays with shape metadata
+    var options = { packed: req.query.packed === 'true' };
+
+    // Stop work for clients that went away or waited too long
+    options.cancel  = new cv.CancellationToken();
+    options.timeout = config.requestTimeout;
+    res.on('close', function() {
+      // Response closed before it was sent: the client is gone
+      if (!res.writableEnded)
+        options.cancel.cancel();
+    });
+
     console.log('Arguments:', util.inspect(inArgs));
-    cv[method](inArgs, function(error, result) {
-      if (error) {
+    cv[method](inArgs, options, function(error, result) {
+      if (error && error.code === 'EQUEUEFULL') {
+        // Overloaded: ask client to come back when the queue is expected to drain
+        var retryAfter = Math.max(1, Math.ceil(cv.getQueueStats().estimatedWaitMs / 1000));
+        res.status(503).set('Retry-After', String(retryAfter)).send({ message: error.message });
+      }
+      else if (error && error.code === 'ETIMEDOUT') {
+        res.status(504).send({ message: error.message });
+      }
+      else if (error && error.code === 'ETOOLARGE') {
+        // Image needs more memory than a single job may use
+        res.status(413).send({ message: error.message });
+      }
+      else if (error && error.code === 'ECANCELED') {
+        // Client has disconnected, nobody to answer to
+      }
+      else if (error) {
         console.log('Error returned');        
         res.send(error);
       }
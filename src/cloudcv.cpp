@@ -14,7 +14,19 @@
 #include "framework/marshal/marshal.hpp"
 #include "modules/HoughLines.hpp"
 #include "modules/IntegralImage.hpp"
+#include "framework/ImageCache.hpp"
+#include "framework/PooledMatAllocator.hpp"
+#include "framework/NativeMemory.hpp"
+#include "framework/ThreadPool.hpp"
+#include "framework/CancellationToken.hpp"
+#include "framework/Pipeline.hpp"
+#include "framework/Tracer.hpp"
+#include "framework/Benchmark.hpp"
+#include "framework/Metrics.hpp"
+#include "framework/TrafficRecorder.hpp"
 #include <nan-check.h>
+#include <cmath>
+#include <limits>
 
 using namespace cloudcv;
 using Nan::GetFunction;
@@ -83,6 +95,28 @@ NAN_METHOD(getInfo)
     }
 }
 
+// Parses optional options argument at given index. Throws JS TypeError and returns false if it is malformed.
+static bool ParseOptionsArgument(Nan::NAN_METHOD_ARGS_TYPE info, int index, ProcessOptions& options)
+{
+    if (!info[index]->IsObject())
+    {
+        Nan::ThrowTypeError("Options argument must be an object");
+        return false;
+    }
+
+    try
+    {
+        options = ParseProcessOptions(info[index].As<v8::Object>());
+    }
+    catch (std::invalid_argument& e)
+    {
+        Nan::ThrowTypeError(e.what());
+        return false;
+    }
+
+    return true;
+}
+
 NAN_METHOD(processFunction)
 {
     Nan::HandleScope scope;
@@ -92,12 +126,67 @@ NAN_METHOD(processFunction)
     v8::Local<v8::Object>   inputArguments;
     v8::Local<v8::Function> resultsCallback;
 
-    if (Nan::Check(info).ArgumentsCount(3)
+    // Options object is optional: processFunction(name, args, [options], callback)
+    const bool hasOptions = info.Length() > 3;
+    const int  callbackIndex = hasOptions ? 3 : 2;
+
+    if (Nan::Check(info).ArgumentsCount(callbackIndex + 1)
         .Argument(0).IsString().Bind(algorithmName)
         .Argument(1).IsObject().Bind(inputArguments)
-        .Argument(2).IsFunction().Bind(resultsCallback)
+        .Argument(callbackIndex).IsFunction().Bind(resultsCallback)
+        .Error(&errorMessage))
+    {
+        ProcessOptions options;
+        if (hasOptions && !ParseOptionsArgument(info, 2, options))
+            return;
+
+        auto algorithm = AlgorithmInfo::Get().find(algorithmName);
+        if (algorithm == AlgorithmInfo::Get().end())
+        {
+            v8::Local<v8::Value> argv[] = { Nan::Error("Algorithm not found"), Nan::Null() };
+            Nan::Callback(resultsCallback).Call(2, argv);
+            return;
+        }
+
+        ProcessAlgorithm(algorithm->second, inputArguments, options, resultsCallback);
+    }
+    else
+    {
+        LOG_TRACE_MESSAGE(errorMessage);
+        Nan::ThrowTypeError(errorMessage.c_str());
+        return;
+    }
+}
+
+NAN_METHOD(processBatch)
+{
+    Nan::HandleScope scope;
+
+    std::string   algorithmName;
+    std::string   errorMessage;
+    v8::Local<v8::Object>   items;
+    v8::Local<v8::Function> resultsCallback;
+
+    // processBatch(name, [args...], [options], callback)
+    const bool hasOptions = info.Length() > 3;
+    const int  callbackIndex = hasOptions ? 3 : 2;
+
+    if (Nan::Check(info).ArgumentsCount(callbackIndex + 1)
+        .Argument(0).IsString().Bind(algorithmName)
+        .Argument(1).IsObject().Bind(items)
+        .Argument(callbackIndex).IsFunction().Bind(resultsCallback)
         .Error(&errorMessage))
     {
+        if (!items->IsArray())
+        {
+            Nan::ThrowTypeError("Batch items must be an array");
+            return;
+        }
+
+        ProcessOptions options;
+        if (hasOptions && !ParseOptionsArgument(info, 2, options))
+            return;
+
         auto algorithm = AlgorithmInfo::Get().find(algorithmName);
         if (algorithm == AlgorithmInfo::Get().end())
         {
@@ -106,7 +195,38 @@ NAN_METHOD(processFunction)
             return;
         }
 
-        ProcessAlgorithm(algorithm->second, inputArguments, resultsCallback);
+        ProcessBatch(algorithm->second, items.As<v8::Array>(), options, resultsCallback);
+    }
+    else
+    {
+        LOG_TRACE_MESSAGE(errorMessage);
+        Nan::ThrowTypeError(errorMessage.c_str());
+        return;
+    }
+}
+
+NAN_METHOD(processPipeline)
+{
+    Nan::HandleScope scope;
+
+    std::string   errorMessage;
+    v8::Local<v8::Object>   spec;
+    v8::Local<v8::Function> resultsCallback;
+
+    // processPipeline(spec, [options], callback)
+    const bool hasOptions = info.Length() > 2;
+    const int  callbackIndex = hasOptions ? 2 : 1;
+
+    if (Nan::Check(info).ArgumentsCount(callbackIndex + 1)
+        .Argument(0).IsObject().Bind(spec)
+        .Argument(callbackIndex).IsFunction().Bind(resultsCallback)
+        .Error(&errorMessage))
+    {
+        ProcessOptions options;
+        if (hasOptions && !ParseOptionsArgument(info, 1, options))
+            return;
+
+        ProcessPipeline(spec, options, resultsCallback);
     }
     else
     {
@@ -116,6 +236,390 @@ NAN_METHOD(processFunction)
     }
 }
 
+NAN_METHOD(getImageCacheStats)
+{
+    info.GetReturnValue().Set(Nan::Marshal(ImageCache::Instance().statistics()));
+}
+
+NAN_METHOD(setImageCacheBudget)
+{
+    double budget = 0;
+    std::string errorMessage;
+
+    if (Nan::Check(info).ArgumentsCount(1)
+        .Argument(0).IsNumber().Bind(budget)
+        .Error(&errorMessage))
+    {
+        if (budget < 0)
+        {
+            Nan::ThrowRangeError("Cache budget cannot be negative");
+            return;
+        }
+
+        ImageCache::Instance().setBudget(static_cast<size_t>(budget));
+    }
+    else
+    {
+        LOG_TRACE_MESSAGE(errorMessage);
+        Nan::ThrowTypeError(errorMessage.c_str());
+        return;
+    }
+}
+
+NAN_METHOD(clearImageCache)
+{
+    ImageCache::Instance().clear();
+}
+
+NAN_METHOD(getMatAllocatorStats)
+{
+    info.GetReturnValue().Set(Nan::Marshal(PooledMatAllocator::Instance().statistics()));
+}
+
+NAN_METHOD(setMatAllocatorLimit)
+{
+    double limit = 0;
+    std::string errorMessage;
+
+    if (Nan::Check(info).ArgumentsCount(1)
+        .Argument(0).IsNumber().Bind(limit)
+        .Error(&errorMessage))
+    {
+        if (limit < 0)
+        {
+            Nan::ThrowRangeError("Pool limit cannot be negative");
+            return;
+        }
+
+        PooledMatAllocator::Instance().setMaxPooledBytes(static_cast<size_t>(limit));
+    }
+    else
+    {
+        LOG_TRACE_MESSAGE(errorMessage);
+        Nan::ThrowTypeError(errorMessage.c_str());
+        return;
+    }
+}
+
+NAN_METHOD(getMemoryStats)
+{
+    NativeMemory::Instance().reportExternalMemory();
+    info.GetReturnValue().Set(Nan::Marshal(NativeMemory::Instance().statistics()));
+}
+
+// getMetrics() returns native counters in Prometheus text format
+NAN_METHOD(getMetrics)
+{
+    NativeMemory::Instance().reportExternalMemory();
+    info.GetReturnValue().Set(New<v8::String>(PrometheusMetrics()).ToLocalChecked());
+}
+
+// Upper bounds of thread pool options, anything above is surely a mistake of the caller
+static const double MaxPoolThreads = 1024;
+static const double MaxStackSize   = 1024.0 * 1024 * 1024;
+static const double MaxSafeInteger = 9007199254740991.0; // Number.MAX_SAFE_INTEGER
+
+// Reads optional non-negative integer property of options object. Throws JS TypeError or RangeError and returns false if it is malformed.
+static bool GetSizeOption(v8::Local<v8::Object> options, const char * name, double maxValue, size_t& value)
+{
+    v8::Local<v8::Value> property = Nan::Get(options, New(name).ToLocalChecked()).ToLocalChecked();
+
+    if (property->IsUndefined())
+        return true;
+
+    if (!property->IsNumber())
+    {
+        Nan::ThrowTypeError((std::string("Option \"") + name + "\" must be a number").c_str());
+        return false;
+    }
+
+    const double number = Nan::To<double>(property).FromJust();
+
+    // Negated comparison also rejects NaN
+    if (!(number >= 0 && number <= maxValue) || std::floor(number) != number)
+    {
+        Nan::ThrowRangeError((std::string("Option \"") + name + "\" must be an integer between 0 and " + std::to_string(static_cast<uint64_t>(maxValue))).c_str());
+        return false;
+    }
+
+    value = static_cast<size_t>(number);
+    return true;
+}
+
+NAN_METHOD(configureThreadPool)
+{
+    std::string errorMessage;
+    v8::Local<v8::Object> optionsObject;
+
+    if (Nan::Check(info).ArgumentsCount(1)
+        .Argument(0).IsObject().Bind(optionsObject)
+        .Error(&errorMessage))
+    {
+        ThreadPoolOptions options = ThreadPool::Instance().configuration();
+
+        if (!GetSizeOption(optionsObject, "threads", MaxPoolThreads, options.threads) ||
+            !GetSizeOption(optionsObject, "stackSize", MaxStackSize, options.stackSize) ||
+            !GetSizeOption(optionsObject, "maxQueueDepth", std::numeric_limits<uint32_t>::max(), options.maxQueueDepth) ||
+            !GetSizeOption(optionsObject, "maxInFlightBytes", MaxSafeInteger, options.maxInFlightBytes) ||
+            !GetSizeOption(optionsObject, "maxJobBytes", MaxSafeInteger, options.maxJobBytes))
+            return;
+
+        v8::Local<v8::Value> name = Nan::Get(optionsObject, New("name").ToLocalChecked()).ToLocalChecked();
+
+        if (name->IsString())
+            options.name = *Nan::Utf8String(name);
+
+        try
+        {
+            ThreadPool::Instance().configure(options);
+        }
+        catch (std::runtime_error& e)
+        {
+            Nan::ThrowError(e.what());
+            return;
+        }
+
+        info.GetReturnValue().Set(Nan::Marshal(ThreadPool::Instance().options()));
+    }
+    else
+    {
+        LOG_TRACE_MESSAGE(errorMessage);
+        Nan::ThrowTypeError(errorMessage.c_str());
+        return;
+    }
+}
+
+NAN_METHOD(getQueueStats)
+{
+    info.GetReturnValue().Set(Nan::Marshal(ThreadPool::Instance().statistics()));
+}
+
+// getStats() returns counters and latency histograms of every algorithm keyed by name
+NAN_METHOD(getStats)
+{
+    Nan::EscapableHandleScope scope;
+
+    v8::Local<v8::Object> stats = Nan::New<v8::Object>();
+
+    for (auto alg : AlgorithmInfo::Get())
+    {
+        Set(stats, New<v8::String>(alg.first).ToLocalChecked(), Nan::Marshal(alg.second->statistics().snapshot()));
+    }
+
+    info.GetReturnValue().Set(scope.Escape(stats));
+}
+
+NAN_METHOD(resetStats)
+{
+    for (auto alg : AlgorithmInfo::Get())
+    {
+        alg.second->statistics().reset();
+    }
+}
+
+NAN_METHOD(startTracing)
+{
+    Tracer::Instance().start();
+}
+
+NAN_METHOD(stopTracing)
+{
+    Tracer::Instance().stop();
+}
+
+// dumpTrace() returns events of the current or last tracing session as Chrome trace JSON string
+NAN_METHOD(dumpTrace)
+{
+    info.GetReturnValue().Set(New<v8::String>(Tracer::Instance().dump()).ToLocalChecked());
+}
+
+// startRecording(path, [options]) logs requests of processFunction, see src/framework/TrafficRecorder.hpp
+NAN_METHOD(startRecording)
+{
+    std::string errorMessage;
+    TrafficRecorder::Options options;
+
+    // startRecording(path, [options])
+    const bool hasOptions = info.Length() > 1;
+
+    if (Nan::Check(info).ArgumentsCount(hasOptions ? 2 : 1)
+        .Argument(0).IsString().Bind(options.path)
+        .Error(&errorMessage))
+    {
+        if (hasOptions)
+        {
+            if (!info[1]->IsObject())
+            {
+                Nan::ThrowTypeError("Options argument must be an object");
+                return;
+            }
+
+            v8::Local<v8::Object> optionsObject = info[1].As<v8::Object>();
+            v8::Local<v8::Value> imageSampleRate = Nan::Get(optionsObject, New("imageSampleRate").ToLocalChecked()).ToLocalChecked();
+            v8::Local<v8::Value> maxBytes        = Nan::Get(optionsObject, New("maxBytes").ToLocalChecked()).ToLocalChecked();
+
+            if (imageSampleRate->IsNumber())
+                options.imageSampleRate = std::min(1.0, std::max(0.0, Nan::To<double>(imageSampleRate).FromJust()));
+
+            if (maxBytes->IsNumber())
+                options.maxBytes = static_cast<size_t>(std::max(0.0, Nan::To<double>(maxBytes).FromJust()));
+        }
+
+        try
+        {
+            TrafficRecorder::Instance().start(options);
+        }
+        catch (std::runtime_error& e)
+        {
+            Nan::ThrowError(e.what());
+            return;
+        }
+    }
+    else
+    {
+        LOG_TRACE_MESSAGE(errorMessage);
+        Nan::ThrowTypeError(errorMessage.c_str());
+        return;
+    }
+}
+
+NAN_METHOD(stopRecording)
+{
+    TrafficRecorder::Instance().stop();
+    info.GetReturnValue().Set(Nan::Marshal(TrafficRecorder::Instance().statistics()));
+}
+
+NAN_METHOD(getRecorderStats)
+{
+    info.GetReturnValue().Set(Nan::Marshal(TrafficRecorder::Instance().statistics()));
+}
+
+// Runs benchmark on a libuv worker thread and passes the JSON report to the callback
+class BenchmarkWorker : public Nan::AsyncWorker
+{
+public:
+    BenchmarkWorker(const BenchmarkOptions& options, Nan::Callback * callback)
+        : Nan::AsyncWorker(callback)
+        , m_options(options)
+    {
+    }
+
+    void Execute() override
+    {
+        try
+        {
+            m_report = BenchmarkReportJson(RunBenchmark(m_options));
+        }
+        catch (std::exception& e)
+        {
+            SetErrorMessage(e.what());
+        }
+    }
+
+    void HandleOKCallback() override
+    {
+        Nan::HandleScope scope;
+
+        v8::Local<v8::Value> argv[] = { Nan::Null(), New<v8::String>(m_report).ToLocalChecked() };
+        callback->Call(2, argv);
+    }
+
+private:
+    BenchmarkOptions m_options;
+    std::string      m_report;
+};
+
+// Reads optional array property of options object. Throws JS TypeError and returns false if it is not an array.
+template <typename T>
+static bool GetArrayOption(v8::Local<v8::Object> options, const char * name, std::vector<T>& value)
+{
+    v8::Local<v8::Value> property = Nan::Get(options, New(name).ToLocalChecked()).ToLocalChecked();
+
+    if (property->IsUndefined())
+        return true;
+
+    if (!property->IsArray())
+    {
+        Nan::ThrowTypeError((std::string("Option \"") + name + "\" must be an array").c_str());
+        return false;
+    }
+
+    value = Nan::Marshal< std::vector<T> >(property);
+    return true;
+}
+
+// runBenchmark([options], callback) passes JSON report of kernel timings, see src/framework/Benchmark.hpp
+NAN_METHOD(runBenchmark)
+{
+    std::string errorMessage;
+    v8::Local<v8::Function> resultsCallback;
+
+    const bool hasOptions = info.Length() > 1;
+    const int  callbackIndex = hasOptions ? 1 : 0;
+
+    if (Nan::Check(info).ArgumentsCount(callbackIndex + 1)
+        .Argument(callbackIndex).IsFunction().Bind(resultsCallback)
+        .Error(&errorMessage))
+    {
+        BenchmarkOptions options;
+
+        if (hasOptions)
+        {
+            if (!info[0]->IsObject())
+            {
+                Nan::ThrowTypeError("Options argument must be an object");
+                return;
+            }
+
+            v8::Local<v8::Object> optionsObject = info[0].As<v8::Object>();
+
+            if (!GetArrayOption(optionsObject, "algorithms", options.algorithms) ||
+                !GetArrayOption(optionsObject, "sizes", options.sizes) ||
+                !GetArrayOption(optionsObject, "channels", options.channels) ||
+                !GetArrayOption(optionsObject, "images", options.images))
+                return;
+
+            v8::Local<v8::Value> warmup     = Nan::Get(optionsObject, New("warmup").ToLocalChecked()).ToLocalChecked();
+            v8::Local<v8::Value> iterations = Nan::Get(optionsObject, New("iterations").ToLocalChecked()).ToLocalChecked();
+            v8::Local<v8::Value> minTimeMs  = Nan::Get(optionsObject, New("minTimeMs").ToLocalChecked()).ToLocalChecked();
+
+            if (warmup->IsNumber())
+                options.warmupIterations = std::max(0, Nan::To<int32_t>(warmup).FromJust());
+
+            if (iterations->IsNumber())
+                options.minIterations = std::max(1, Nan::To<int32_t>(iterations).FromJust());
+
+            if (minTimeMs->IsNumber())
+                options.minTimeMs = std::max(0.0, Nan::To<double>(minTimeMs).FromJust());
+        }
+
+        for (int channels : options.channels)
+        {
+            if (channels != 1 && channels != 3 && channels != 4)
+            {
+                Nan::ThrowRangeError("Channel count must be 1, 3 or 4");
+                return;
+            }
+        }
+
+        for (const auto& size : options.sizes)
+        {
+            if (size.width <= 0 || size.height <= 0)
+            {
+                Nan::ThrowRangeError("Image size must be positive");
+                return;
+            }
+        }
+
+        Nan::AsyncQueueWorker(new BenchmarkWorker(options, new Nan::Callback(resultsCallback)));
+    }
+    else
+    {
+        LOG_TRACE_MESSAGE(errorMessage);
+        Nan::ThrowTypeError(errorMessage.c_str());
+        return;
+    }
+}
 
 NAN_MODULE_INIT(RegisterModule)
 {
@@ -123,6 +627,8 @@ NAN_MODULE_INIT(RegisterModule)
     signal(SIGSEGV, handler);   // install our handler
 #endif
 
+    cv::Mat::setDefaultAllocator(&PooledMatAllocator::Instance());
+
     AlgorithmInfo::Register(new HoughLinesAlgorithmInfo);
     AlgorithmInfo::Register(new IntegralImageAlgorithmInfo);
 
@@ -134,9 +640,91 @@ NAN_MODULE_INIT(RegisterModule)
         New<v8::String>("processFunction").ToLocalChecked(),
         GetFunction(New<v8::FunctionTemplate>(processFunction)).ToLocalChecked());
 
+    Set(target,
+        New<v8::String>("processBatch").ToLocalChecked(),
+        GetFunction(New<v8::FunctionTemplate>(processBatch)).ToLocalChecked());
+
+    Set(target,
+        New<v8::String>("processPipeline").ToLocalChecked(),
+        GetFunction(New<v8::FunctionTemplate>(processPipeline)).ToLocalChecked());
+
     Set(target,
         New<v8::String>("getInfo").ToLocalChecked(),
         GetFunction(New<v8::FunctionTemplate>(getInfo)).ToLocalChecked());
+
+    Set(target,
+        New<v8::String>("getImageCacheStats").ToLocalChecked(),
+        GetFunction(New<v8::FunctionTemplate>(getImageCacheStats)).ToLocalChecked());
+
+    Set(target,
+        New<v8::String>("setImageCacheBudget").ToLocalChecked(),
+        GetFunction(New<v8::FunctionTemplate>(setImageCacheBudget)).ToLocalChecked());
+
+    Set(target,
+        New<v8::String>("clearImageCache").ToLocalChecked(),
+        GetFunction(New<v8::FunctionTemplate>(clearImageCache)).ToLocalChecked());
+
+    Set(target,
+        New<v8::String>("getMatAllocatorStats").ToLocalChecked(),
+        GetFunction(New<v8::FunctionTemplate>(getMatAllocatorStats)).ToLocalChecked());
+
+    Set(target,
+        New<v8::String>("setMatAllocatorLimit").ToLocalChecked(),
+        GetFunction(New<v8::FunctionTemplate>(setMatAllocatorLimit)).ToLocalChecked());
+
+    Set(target,
+        New<v8::String>("getMemoryStats").ToLocalChecked(),
+        GetFunction(New<v8::FunctionTemplate>(getMemoryStats)).ToLocalChecked());
+
+    Set(target,
+        New<v8::String>("getMetrics").ToLocalChecked(),
+        GetFunction(New<v8::FunctionTemplate>(getMetrics)).ToLocalChecked());
+
+    Set(target,
+        New<v8::String>("configureThreadPool").ToLocalChecked(),
+        GetFunction(New<v8::FunctionTemplate>(configureThreadPool)).ToLocalChecked());
+
+    Set(target,
+        New<v8::String>("getQueueStats").ToLocalChecked(),
+        GetFunction(New<v8::FunctionTemplate>(getQueueStats)).ToLocalChecked());
+
+    Set(target,
+        New<v8::String>("getStats").ToLocalChecked(),
+        GetFunction(New<v8::FunctionTemplate>(getStats)).ToLocalChecked());
+
+    Set(target,
+        New<v8::String>("resetStats").ToLocalChecked(),
+        GetFunction(New<v8::FunctionTemplate>(resetStats)).ToLocalChecked());
+
+    Set(target,
+        New<v8::String>("startTracing").ToLocalChecked(),
+        GetFunction(New<v8::FunctionTemplate>(startTracing)).ToLocalChecked());
+
+    Set(target,
+        New<v8::String>("stopTracing").ToLocalChecked(),
+        GetFunction(New<v8::FunctionTemplate>(stopTracing)).ToLocalChecked());
+
+    Set(target,
+        New<v8::String>("dumpTrace").ToLocalChecked(),
+        GetFunction(New<v8::FunctionTemplate>(dumpTrace)).ToLocalChecked());
+
+    Set(target,
+        New<v8::String>("runBenchmark").ToLocalChecked(),
+        GetFunction(New<v8::FunctionTemplate>(runBenchmark)).ToLocalChecked());
+
+    Set(target,
+        New<v8::String>("startRecording").ToLocalChecked(),
+        GetFunction(New<v8::FunctionTemplate>(startRecording)).ToLocalChecked());
+
+    Set(target,
+        New<v8::String>("stopRecording").ToLocalChecked(),
+        GetFunction(New<v8::FunctionTemplate>(stopRecording)).ToLocalChecked());
+
+    Set(target,
+        New<v8::String>("getRecorderStats").ToLocalChecked(),
+        GetFunction(New<v8::FunctionTemplate>(getRecorderStats)).ToLocalChecked());
+
+    CancellationTokenWrap::Init(target);
 }
 
 NODE_MODULE(cloudcv, RegisterModule);
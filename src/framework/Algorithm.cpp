@@ -2,6 +2,9 @@
 #include "framework/Logger.hpp"
 #include "framework/ScopedTimer.hpp"
 #include "framework/Job.hpp"
+#include "framework/ThreadPool.hpp"
+#include "framework/ContentHash.hpp"
+#include "framework/TrafficRecorder.hpp"
 #include "framework/marshal/marshal.hpp"
 //#include "framework/NanCheck.hpp"
 
@@ -9,29 +12,239 @@
 #include <v8.h>
 #include <nan.h>
 
+#include <chrono>
+#include <unordered_map>
+#include <limits>
+#include <stdexcept>
+
 namespace cloudcv
 {
+    class AlgorithmTask;
+
+    namespace
+    {
+        /**
+         * @brief Binds JS arguments to algorithm inputs and creates output bindings. Must be called from the V8 thread.
+         * @details Arguments are either an object keyed by argument name or an array of values 
+         *          in slot order (see "slot" in getInfo), which skips property lookups entirely.
+         *          Missing and undefined values are treated as not specified.
+         */
+        void BindArguments(const AlgorithmInfo& info, v8::Local<v8::Object> inputArguments, ArgumentBindings& inArgs, ArgumentBindings& outArgs)
+        {
+            inArgs = ArgumentBindings(info.inputSlots().size());
+            outArgs = ArgumentBindings(info.outputSlots().size());
+
+            const bool positional = inputArguments->IsArray();
+
+            if (positional && inputArguments.As<v8::Array>()->Length() > info.inputSlots().size())
+                throw std::runtime_error("Too many positional arguments for " + info.name());
+
+            for (const auto& arg : info.inputSlots())
+            {
+                v8::Local<v8::Value> argumentValue = positional
+                    ? Nan::Get(inputArguments, static_cast<uint32_t>(arg->slot())).ToLocalChecked()
+                    : Nan::Get(inputArguments, info.inputPropertyName(arg->slot())).ToLocalChecked();
+
+                LOG_TRACE_MESSAGE("Binding input argument " << arg->name());
+                inArgs[arg->slot()] = arg->bind(argumentValue);
+            }
+
+            for (const auto& arg : info.outputSlots())
+            {
+                LOG_TRACE_MESSAGE("Binding output argument " << arg->name());
+                outArgs[arg->slot()] = arg->bind();
+            }
+        }
+
+        v8::Local<v8::Object> MarshalOutputs(const AlgorithmInfo& info, const ArgumentBindings& outArgs, bool packed)
+        {
+            Nan::EscapableHandleScope scope;
+
+            v8::Local<v8::Object> outputArgument = Nan::New<v8::Object>();
+
+            for (const auto& arg : info.outputSlots())
+            {
+                const ParameterBindingPtr& binding = outArgs[arg->slot()];
+                auto value = packed ? binding->marshalPackedFromNative() : binding->marshalFromNative();
+                Nan::Set(outputArgument, info.outputPropertyName(arg->slot()), value);
+            }
+
+            return scope.Escape(outputArgument);
+        }
+
+        size_t BindingsMemoryEstimate(const ArgumentBindings& bindings)
+        {
+            size_t bytes = 0;
+
+            for (const auto& binding : bindings)
+                bytes += binding->memoryEstimate();
+
+            return bytes;
+        }
+
+        /**
+         * Jobs that can be joined by identical requests, keyed by algorithm, inputs and options.
+         * Accessed from the V8 thread only.
+         */
+        std::unordered_map<uint64_t, AlgorithmTask*>& InFlightTasks()
+        {
+            static std::unordered_map<uint64_t, AlgorithmTask*> tasks;
+            return tasks;
+        }
+
+        bool RequestKey(const AlgorithmInfo& info, const ArgumentBindings& inArgs, const ProcessOptions& options, uint64_t& key)
+        {
+            if (!options.coalesce)
+                return false;
+
+            const std::string name = info.name();
+            // Options that change what callbacks receive are part of the key
+            const uint64_t resultFormat = (options.packed ? 1 : 0) | (options.timings ? 2 : 0);
+            key = HashCombine(ContentHash(name.data(), name.size()), resultFormat);
+
+            for (const auto& binding : inArgs)
+            {
+                if (!binding->hash(key))
+                    return false;
+            }
+
+            return true;
+        }
+    }
+
     class AlgorithmTask : public Job
     {
+        AlgorithmInfoPtr                           m_info;
         AlgorithmPtr                               m_algorithm;
-        std::map<std::string, ParameterBindingPtr> m_input;
-        std::map<std::string, ParameterBindingPtr> m_output;
+        ArgumentBindings                           m_input;
+        ArgumentBindings                           m_output;
+        ProcessOptions                             m_options;
+
+        struct Follower
+        {
+            std::unique_ptr<Nan::Callback> callback;
+            CancellationToken              cancellation;
+        };
+
+        //! Identical requests that receive result of this job
+        std::vector<Follower>                      m_followers;
+        uint64_t                                   m_requestKey;
+        bool                                       m_registered;
 
     public:
 
         AlgorithmTask(
-            AlgorithmPtr alg, 
-            std::map<std::string, ParameterBindingPtr> inArgs,
-            std::map<std::string, ParameterBindingPtr> outArgs,
+            AlgorithmInfoPtr info,
+            const ArgumentBindings& inArgs,
+            const ArgumentBindings& outArgs,
+            const ProcessOptions& options,
             Nan::Callback * callback)
             : Job(callback)
-            , m_algorithm(alg)
+            , m_info(info)
+            , m_algorithm(info->create())
             , m_input(inArgs)
             , m_output(outArgs)
+            , m_options(options)
+            , m_requestKey(0)
+            , m_registered(false)
         {
             TRACE_FUNCTION;
             LOG_TRACE_MESSAGE("Input arguments:" << inArgs.size());
             LOG_TRACE_MESSAGE("Output arguments:" << outArgs.size());
+            setCancellationToken(options.cancellation);
+
+            if (options.coalesce)
+                cancellationToken().allowCallers();
+        }
+
+        size_t memoryEstimate() const override
+        {
+            return BindingsMemoryEstimate(m_input);
+        }
+
+        //! Makes the job visible to identical requests until it completes
+        void registerInFlight(uint64_t requestKey)
+        {
+            m_requestKey = requestKey;
+            m_registered = true;
+            InFlightTasks()[requestKey] = this;
+        }
+
+        /**
+         * @brief Confirms that a request whose key matched really is identical,
+         *        so a hash collision never hands one caller another caller's result.
+         */
+        bool matches(const ArgumentBindings& inArgs, const ProcessOptions& options) const
+        {
+            if (options.packed != m_options.packed || options.timings != m_options.timings || inArgs.size() != m_input.size())
+                return false;
+
+            for (size_t slot = 0; slot < m_input.size(); slot++)
+            {
+                if (!m_input[slot]->equals(*inArgs[slot]))
+                    return false;
+            }
+
+            return true;
+        }
+
+        //! False once the job is being stopped, new callers must not join it then
+        bool acceptsFollowers() const
+        {
+            return !cancellationToken().isStopRequested();
+        }
+
+        /**
+         * @brief Attaches identical request to this job. The job now serves several 
+         *        callers and stops only when all of them cancelled or timed out; 
+         *        each caller whose token fired gets its own error on completion.
+         */
+        void addFollower(Nan::Callback * callback, const CancellationToken& cancellation)
+        {
+            Follower follower;
+            follower.callback.reset(callback);
+            follower.cancellation = cancellation;
+            m_followers.push_back(std::move(follower));
+
+            cancellationToken().addCaller(cancellation);
+        }
+
+        void HandleOKCallback() override
+        {
+            unregisterInFlight();
+
+            if (m_followers.empty())
+            {
+                Job::HandleOKCallback();
+                return;
+            }
+
+            // Every caller gets its own result objects
+            deliver(callback, cancellationToken());
+
+            for (const auto& follower : m_followers)
+                deliver(follower.callback.get(), follower.cancellation);
+        }
+
+        void HandleErrorCallback() override
+        {
+            unregisterInFlight();
+            Job::HandleErrorCallback();
+
+            const bool stopped = ErrorCode() == "ECANCELED" || ErrorCode() == "ETIMEDOUT";
+
+            for (auto& follower : m_followers)
+            {
+                Nan::HandleScope scope;
+                std::string message, code;
+
+                if (!stopped)
+                    InvokeCallback(follower.callback.get(), CreateErrorObject(ErrorMessage(), ErrorCode()), Nan::Null());
+                else if (follower.cancellation.cancellationError(message, code))
+                    InvokeCallback(follower.callback.get(), CreateErrorObject(message, code), Nan::Null());
+                else
+                    resubmit(follower); // Joined just as the job was being stopped
+            }
         }
 
     protected:
@@ -46,7 +259,14 @@ namespace cloudcv
             try
             {
                 TRACE_FUNCTION;
-                m_algorithm->process(m_input, m_output);
+                m_algorithm->setCancellationToken(&cancellationToken());
+                RunAlgorithm(*m_info, *m_algorithm, m_input, m_output, queuedTimeMs());
+            }
+            catch (OperationCancelledException& err)
+            {
+                LOG_TRACE_MESSAGE("OperationCancelledException:" << err.what());
+                SetErrorMessage(err.what());
+                SetErrorCode(err.code());
             }
             catch (ArgumentException& err)
             {
@@ -72,20 +292,301 @@ namespace cloudcv
             TRACE_FUNCTION;            
 
             Nan::EscapableHandleScope scope;
+            return scope.Escape(MarshalOutputs(*m_info, m_output, m_options.packed));
+        }
 
-            v8::Local<v8::Object> outputArgument = Nan::New<v8::Object>();
+    private:
+
+        //! Runs request of a follower whose caller is still waiting as a job of its own
+        void resubmit(Follower& follower)
+        {
+            ProcessOptions options = m_options;
+            options.cancellation = follower.cancellation;
+
+            ArgumentBindings outArgs(m_info->outputSlots().size());
+            for (const auto& arg : m_info->outputSlots())
+                outArgs[arg->slot()] = arg->bind();
+
+            AlgorithmTask * task = new AlgorithmTask(m_info, m_input, outArgs, options, follower.callback.release());
+
+            if (options.timings)
+                task->enableTimings();
+
+            ThreadPool::Instance().enqueue(task);
+        }
+
+        void deliver(Nan::Callback * target, const CancellationToken& cancellation)
+        {
+            Nan::HandleScope scope;
+            std::string message, code;
+
+            if (cancellation.cancellationError(message, code))
+                InvokeCallback(target, CreateErrorObject(message, code), Nan::Null());
+            else
+                InvokeCallback(target, Nan::Null(), MarshalResult());
+        }
+
+        void unregisterInFlight()
+        {
+            if (!m_registered)
+                return;
+
+            auto it = InFlightTasks().find(m_requestKey);
+            if (it != InFlightTasks().end() && it->second == this)
+                InFlightTasks().erase(it);
+
+            m_registered = false;
+        }
+    };
+
+    /**
+     * @brief Runs one algorithm over many argument sets as a single job.
+     *        Items are processed in parallel on the thread pool; failure of 
+     *        one item does not affect the others.
+     */
+    class BatchTask : public Job
+    {
+        struct Item
+        {
+            AlgorithmPtr     algorithm;
+            ArgumentBindings input;
+            ArgumentBindings output;
+            std::string      errorMessage;
+            std::string      errorCode;
+        };
 
-            for (const auto& arg : m_output)
+        AlgorithmInfoPtr  m_info;
+        std::vector<Item> m_items;
+        ProcessOptions    m_options;
+
+    public:
+
+        BatchTask(AlgorithmInfoPtr info, v8::Local<v8::Array> items, const ProcessOptions& options, Nan::Callback * callback)
+            : Job(callback)
+            , m_info(info)
+            , m_items(items->Length())
+            , m_options(options)
+        {
+            TRACE_FUNCTION;
+            setCancellationToken(options.cancellation);
+
+            for (uint32_t i = 0; i < items->Length(); i++)
             {
-                outputArgument->Set(Nan::Marshal(arg.first), arg.second->marshalFromNative());
+                Item& item = m_items[i];
+                v8::Local<v8::Value> arguments = Nan::Get(items, i).ToLocalChecked();
+
+                if (!arguments->IsObject())
+                {
+                    item.errorMessage = "Batch item must be an object";
+                    continue;
+                }
+
+                try
+                {
+                    BindArguments(*info, arguments.As<v8::Object>(), item.input, item.output);
+                    item.algorithm = info->create();
+                }
+                catch (ArgumentException& err)
+                {
+                    item.errorMessage = err.what();
+                }
+                catch (cv::Exception& err)
+                {
+                    item.errorMessage = err.what();
+                }
+                catch (std::runtime_error& err)
+                {
+                    item.errorMessage = err.what();
+                }
             }
+        }
 
-            return scope.Escape(outputArgument);
+        size_t memoryEstimate() const override
+        {
+            size_t bytes = 0;
+
+            for (const auto& item : m_items)
+                bytes += BindingsMemoryEstimate(item.input);
+
+            return bytes;
+        }
+
+    protected:
+
+        void ExecuteNativeCode() override
+        {
+            TRACE_FUNCTION;
+            ThreadPool::Instance().parallelFor(m_items.size(), [this](size_t index) { processItem(m_items[index]); });
+        }
+
+        v8::Local<v8::Value> CreateCallbackResult() override
+        {
+            TRACE_FUNCTION;
+
+            Nan::EscapableHandleScope scope;
+
+            v8::Local<v8::Array> results = Nan::New<v8::Array>(static_cast<uint32_t>(m_items.size()));
+
+            for (uint32_t i = 0; i < m_items.size(); i++)
+            {
+                const Item& item = m_items[i];
+                v8::Local<v8::Object> result = Nan::New<v8::Object>();
+
+                if (item.errorMessage.empty())
+                {
+                    Nan::Set(result, Nan::New("error").ToLocalChecked(), Nan::Null());
+                    Nan::Set(result, Nan::New("result").ToLocalChecked(), MarshalOutputs(*m_info, item.output, m_options.packed));
+                }
+                else
+                {
+                    Nan::Set(result, Nan::New("error").ToLocalChecked(), CreateErrorObject(item.errorMessage, item.errorCode));
+                    Nan::Set(result, Nan::New("result").ToLocalChecked(), Nan::Null());
+                }
+
+                Nan::Set(results, i, result);
+            }
+
+            return scope.Escape(results);
+        }
+
+    private:
+
+        void processItem(Item& item)
+        {
+            if (!item.algorithm)
+                return;
+
+            try
+            {
+                cancellationToken().throwIfCancelled();
+
+                item.algorithm->setCancellationToken(&cancellationToken());
+                RunAlgorithm(*m_info, *item.algorithm, item.input, item.output, queuedTimeMs());
+            }
+            catch (OperationCancelledException& err)
+            {
+                item.errorMessage = err.what();
+                item.errorCode = err.code();
+            }
+            catch (MemoryLimitExceededException& err)
+            {
+                item.errorMessage = err.what();
+                item.errorCode = "ETOOLARGE";
+            }
+            catch (ArgumentException& err)
+            {
+                item.errorMessage = err.what();
+            }
+            catch (cv::Exception& err)
+            {
+                item.errorMessage = err.what();
+            }
+            catch (std::runtime_error& err)
+            {
+                item.errorMessage = err.what();
+            }
+            catch (...)
+            {
+                item.errorMessage = "Unknown error";
+            }
+
+            // Inputs may pin JS buffers and are released on the V8 thread with the task
+            item.algorithm.reset();
         }
     };
 
 
-    void ProcessAlgorithm(AlgorithmInfoPtr algorithm, v8::Local<v8::Object> inputArguments, v8::Local<v8::Function> resultsCallback)
+    ProcessOptions::ProcessOptions()
+        : packed(false)
+        , coalesce(true)
+        , timings(false)
+    {
+    }
+
+    ProcessOptions ParseProcessOptions(v8::Local<v8::Object> options)
+    {
+        ProcessOptions result;
+
+        v8::Local<v8::Value> packed = Nan::Get(options, Nan::New("packed").ToLocalChecked()).ToLocalChecked();
+        result.packed = Nan::To<bool>(packed).FromMaybe(false);
+
+        v8::Local<v8::Value> coalesce = Nan::Get(options, Nan::New("coalesce").ToLocalChecked()).ToLocalChecked();
+        if (!coalesce->IsUndefined())
+            result.coalesce = Nan::To<bool>(coalesce).FromMaybe(true);
+
+        v8::Local<v8::Value> timings = Nan::Get(options, Nan::New("timings").ToLocalChecked()).ToLocalChecked();
+        result.timings = Nan::To<bool>(timings).FromMaybe(false);
+
+        v8::Local<v8::Value> cancel = Nan::Get(options, Nan::New("cancel").ToLocalChecked()).ToLocalChecked();
+        if (!cancel->IsUndefined() && !cancel->IsNull())
+        {
+            if (!CancellationTokenWrap::HasInstance(cancel))
+                throw std::invalid_argument("Option 'cancel' must be a CancellationToken");
+
+            auto token = Nan::ObjectWrap::Unwrap<CancellationTokenWrap>(cancel.As<v8::Object>());
+            result.cancellation.attach(token->flag());
+        }
+
+        // Both timeout and deadline may be given; the earlier one wins
+        double timeoutMs = std::numeric_limits<double>::infinity();
+
+        v8::Local<v8::Value> timeout = Nan::Get(options, Nan::New("timeout").ToLocalChecked()).ToLocalChecked();
+        if (!timeout->IsUndefined())
+        {
+            if (!timeout->IsNumber() || Nan::To<double>(timeout).FromJust() < 0)
+                throw std::invalid_argument("Option 'timeout' must be a non-negative number of milliseconds");
+
+            timeoutMs = Nan::To<double>(timeout).FromJust();
+        }
+
+        v8::Local<v8::Value> deadline = Nan::Get(options, Nan::New("deadline").ToLocalChecked()).ToLocalChecked();
+        if (!deadline->IsUndefined())
+        {
+            if (!deadline->IsNumber() && !deadline->IsDate())
+                throw std::invalid_argument("Option 'deadline' must be a Date or a number of milliseconds since epoch");
+
+            using namespace std::chrono;
+            const double nowMs = static_cast<double>(duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count());
+            timeoutMs = std::min(timeoutMs, std::max(0.0, Nan::To<double>(deadline).FromJust() - nowMs));
+        }
+
+        if (timeoutMs != std::numeric_limits<double>::infinity())
+            result.cancellation.setTimeout(timeoutMs);
+
+        return result;
+    }
+
+    void RunAlgorithm(const AlgorithmInfo& info, Algorithm& algorithm, const ArgumentBindings& inArgs, const ArgumentBindings& outArgs, double queueTimeMs)
+    {
+        AlgorithmStats::Sample sample(queueTimeMs, BindingsMemoryEstimate(inArgs));
+        ScopedTimer timer;
+
+        try
+        {
+            ScopedStage stage(RequestTimings::Kernel);
+            algorithm.process(inArgs, outArgs);
+        }
+        catch (OperationCancelledException&)
+        {
+            sample.cancelled = true;
+            sample.executionTimeMs = timer.executionTimeMs();
+            info.statistics().record(sample);
+            throw;
+        }
+        catch (...)
+        {
+            sample.failed = true;
+            sample.executionTimeMs = timer.executionTimeMs();
+            info.statistics().record(sample);
+            throw;
+        }
+
+        sample.executionTimeMs = timer.executionTimeMs();
+        sample.bytesOut = BindingsMemoryEstimate(outArgs);
+        info.statistics().record(sample);
+    }
+
+    void ProcessAlgorithm(AlgorithmInfoPtr algorithm, v8::Local<v8::Object> inputArguments, const ProcessOptions& options, v8::Local<v8::Function> resultsCallback)
     {
         TRACE_FUNCTION;
         
@@ -99,28 +600,27 @@ namespace cloudcv
         {
             //Nan::TryCatch trycatch;
 
-            auto info = algorithm;
-            std::map<std::string, ParameterBindingPtr> inArgs, outArgs;
-
-            for (auto arg : info->inputArguments())
-            {
-                auto propertyName = Nan::Marshal(arg.first);
-                v8::Local<v8::Value> argumentValue = Nan::Null();
+            ScopedTimer bindTimer;
+            ArgumentBindings inArgs, outArgs;
+            BindArguments(*algorithm, inputArguments, inArgs, outArgs);
+            const double bindTimeMs = bindTimer.executionTimeMs();
+            RequestTimings::StageHistogram(RequestTimings::Bind).record(bindTimeMs);
 
-                if (inputArguments->HasRealNamedProperty(propertyName->ToString()))
-                    argumentValue = inputArguments->Get(propertyName);
+            if (TrafficRecorder::Enabled())
+                TrafficRecorder::Instance().record(*algorithm, inArgs);
 
-                LOG_TRACE_MESSAGE("Binding input argument " << arg.first);
-                auto bind = arg.second->bind(argumentValue);
+            uint64_t requestKey = 0;
+            const bool coalescable = RequestKey(*algorithm, inArgs, options, requestKey);
 
-                inArgs.insert(std::make_pair(arg.first, bind));
-            }
-
-            for (auto arg : info->outputArguments())
+            if (coalescable)
             {
-                LOG_TRACE_MESSAGE("Binding output argument " << arg.first);
-                auto bind = arg.second->bind();
-                outArgs.insert(std::make_pair(arg.first, bind));
+                auto leader = InFlightTasks().find(requestKey);
+                if (leader != InFlightTasks().end() && leader->second->acceptsFollowers() && leader->second->matches(inArgs, options))
+                {
+                    LOG_TRACE_MESSAGE("Attaching to identical job in flight");
+                    leader->second->addFollower(new Nan::Callback(resultsCallback), options.cancellation);
+                    return;
+                }
             }
 
             //if (trycatch.HasCaught())
@@ -132,7 +632,15 @@ namespace cloudcv
             //if (trycatch.CanContinue())
             {
                 Nan::Callback * callback = new Nan::Callback(resultsCallback);
-                Nan::AsyncQueueWorker(new AlgorithmTask(algorithm->create(), inArgs, outArgs, callback));
+                AlgorithmTask * task = new AlgorithmTask(algorithm, inArgs, outArgs, options, callback);
+
+                if (options.timings)
+                    task->enableTimings().stageMs[RequestTimings::Bind] = bindTimeMs;
+
+                // Rejected job only waits for its error callback and is not registered. On a key
+                // collision with a different request the job in flight keeps its registration.
+                if (ThreadPool::Instance().enqueue(task) && coalescable && InFlightTasks().count(requestKey) == 0)
+                    task->registerInFlight(requestKey);
             }
         }
         catch (cv::Exception& er)
@@ -164,6 +672,12 @@ namespace cloudcv
 
     }
 
+    void ProcessBatch(AlgorithmInfoPtr algorithm, v8::Local<v8::Array> items, const ProcessOptions& options, v8::Local<v8::Function> resultsCallback)
+    {
+        TRACE_FUNCTION;
+        Nan::HandleScope scope;
 
-
+        Nan::Callback * callback = new Nan::Callback(resultsCallback);
+        ThreadPool::Instance().enqueue(new BatchTask(algorithm, items, options, callback));
+    }
 }
\ No newline at end of file
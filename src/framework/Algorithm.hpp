@@ -10,6 +10,7 @@
 #include <nan.h>
 
 #include "framework/AlgorithmExceptions.hpp"
+#include "framework/CancellationToken.hpp"
 #include "framework/AlgorithmInfo.hpp"
 #include "framework/Argument.hpp"
 
@@ -33,57 +34,83 @@ namespace cloudcv
     public:
         virtual ~Algorithm() = default;
         virtual void process(
-            const std::map<std::string, ParameterBindingPtr>& inArgs,
-            const std::map<std::string, ParameterBindingPtr>& outArgs
+            const ArgumentBindings& inArgs,
+            const ArgumentBindings& outArgs
             ) = 0;
 
+        //! Token of the job that runs this algorithm; may be null
+        void setCancellationToken(const CancellationToken * token)
+        {
+            m_cancellation = token;
+        }
 
     protected:
 
+        /**
+         * @brief Long-running algorithms should call this between processing stages
+         *        to stop early when the job was cancelled or ran out of time.
+         */
+        void throwIfCancelled() const
+        {
+            if (m_cancellation != nullptr)
+                m_cancellation->throwIfCancelled();
+        }
 
+        //! Argument tags define name(), type and slot of the argument
         template <typename T>
-        static inline const typename T::type& getInput(const std::map<std::string, ParameterBindingPtr>& inputArgs)
+        static inline const typename T::type& getInput(const ArgumentBindings& inputArgs)
         {
-            auto it = inputArgs.find(T::name());
-
-            if (inputArgs.end() == it)
-            {
-                throw ArgumentException(T::name(), "Cannot find parameter");
-            }
-
-            auto binding = it->second;
-
-            auto * bind = dynamic_cast<const TypedBinding<typename T::type>*>(it->second.get());
-            if (bind == nullptr)
-            {
-                throw ArgumentTypeMismatchException(T::name(), binding->type(), TypedBinding<typename T::type>::static_type());
-            }
-
-            return bind->get();
+            return inputArgs.value<typename T::type>(T::slot);
         }
 
         template <typename T>
-        static inline typename T::type& getOutput(const std::map<std::string, ParameterBindingPtr>& outputArgs)
+        static inline typename T::type& getOutput(const ArgumentBindings& outputArgs)
         {
-            auto it = outputArgs.find(T::name());
+            return outputArgs.value<typename T::type>(T::slot);
+        }
 
-            if (outputArgs.end() == it)
-            {
-                throw ArgumentException(T::name(), "Cannot find parameter");
-            }
+    private:
+        const CancellationToken * m_cancellation = nullptr;
+    };
 
-            auto binding = it->second;
+    typedef std::shared_ptr<Algorithm> AlgorithmPtr;
 
-            auto * bind = dynamic_cast<TypedBinding<typename T::type>*>(it->second.get());
-            if (bind == nullptr)
-                throw ArgumentTypeMismatchException(T::name(), binding->type(), TypedBinding<typename T::type>::static_type());
+    /**
+     * @brief Per-call options of processFunction.
+     */
+    struct ProcessOptions
+    {
+        ProcessOptions();
 
-            return bind->get();
-        }
+        //! Marshal vector outputs (points, rectangles, vectors) as packed typed arrays
+        bool packed;
+
+        //! Attach to an identical job that is already in flight instead of running again
+        bool coalesce;
+
+        //! Pass breakdown of time per processing stage as the third callback argument
+        bool timings;
+
+        //! Abort flag and deadline taken from "cancel", "timeout" (ms) and "deadline" (Date or epoch ms) options
+        CancellationToken cancellation;
     };
 
-    typedef std::shared_ptr<Algorithm> AlgorithmPtr;
+    /**
+     * @brief Runs algorithm instance on bound arguments and records call counters, 
+     *        bytes in/out and latencies in statistics of its AlgorithmInfo. 
+     *        Exceptions of the algorithm are propagated. Worker thread only.
+     */
+    void RunAlgorithm(const AlgorithmInfo& info, Algorithm& algorithm, const ArgumentBindings& inArgs, const ArgumentBindings& outArgs, double queueTimeMs);
+
+    //! Throws std::invalid_argument if options are malformed
+    ProcessOptions ParseProcessOptions(v8::Local<v8::Object> options);
+
+    void ProcessAlgorithm(AlgorithmInfoPtr algorithm, v8::Local<v8::Object> args, const ProcessOptions& options, v8::Local<v8::Function> resultsCallback);
 
-    void ProcessAlgorithm(AlgorithmInfoPtr algorithm, v8::Local<v8::Object> args, v8::Local<v8::Function> resultsCallback);
+    /**
+     * @brief Runs algorithm over array of argument objects as one job.
+     *        Callback receives array of {error, result} objects in the order of items.
+     */
+    void ProcessBatch(AlgorithmInfoPtr algorithm, v8::Local<v8::Array> items, const ProcessOptions& options, v8::Local<v8::Function> resultsCallback);
 
 }
\ No newline at end of file
@@ -35,4 +35,20 @@ namespace cloudcv
     {
     }
 
+    OperationCancelledException::OperationCancelledException(const std::string& message, const std::string& code)
+        : std::runtime_error(message)
+        , m_code(code)
+    {
+    }
+
+    const std::string& OperationCancelledException::code() const CLOUDCV_NOTHROW
+    {
+        return m_code;
+    }
+
+    MemoryLimitExceededException::MemoryLimitExceededException(size_t limit)
+        : std::runtime_error("Job exceeded memory limit of " + std::to_string(limit) + " bytes")
+    {
+    }
+
 }
\ No newline at end of file
@@ -41,4 +41,29 @@ namespace cloudcv
     public:
         ArgumentBindException(std::string argumentName, std::string message);
     };
+
+    /**
+     * @brief Thrown when job was cancelled or its deadline has passed.
+     */
+    class OperationCancelledException : public std::runtime_error
+    {
+    public:
+        OperationCancelledException(const std::string& message, const std::string& code);
+
+        //! Error code reported to JS: ECANCELED or ETIMEDOUT
+        const std::string& code() const CLOUDCV_NOTHROW;
+
+    private:
+        std::string m_code;
+    };
+
+    /**
+     * @brief Thrown when a job allocates more native memory than allowed per job.
+     *        Reported to JS with ETOOLARGE error code.
+     */
+    class MemoryLimitExceededException : public std::runtime_error
+    {
+    public:
+        MemoryLimitExceededException(size_t limit);
+    };
 }
\ No newline at end of file
@@ -8,13 +8,22 @@ namespace cloudcv
         std::initializer_list<std::pair<std::string, InputArgumentPtr>> in,
         std::initializer_list<std::pair<std::string, OutputArgumentPtr>> out)
         : m_name(name)
-
+        , m_stats(std::make_shared<AlgorithmStats>())
+        , m_inputSlots(in.size())
+        , m_outputSlots(out.size())
     {
+        // Slots of argument tags must form a dense range, so bindings can be accessed by index
         for (auto i : in)
         {
             auto res = m_inputParams.insert(i);
             if (!res.second)
                 throw ArgumentException(i.first, "Duplicate argument name");
+
+            const size_t slot = i.second->slot();
+            if (slot >= m_inputSlots.size() || m_inputSlots[slot])
+                throw ArgumentException(i.first, "Invalid or duplicate argument slot");
+
+            m_inputSlots[slot] = i.second;
         }
 
         for (auto o : out)
@@ -22,10 +31,49 @@ namespace cloudcv
             auto res = m_outputParams.insert(o);
             if (!res.second)
                 throw ArgumentException(o.first, "Duplicate argument name");
+
+            const size_t slot = o.second->slot();
+            if (slot >= m_outputSlots.size() || m_outputSlots[slot])
+                throw ArgumentException(o.first, "Invalid or duplicate argument slot");
+
+            m_outputSlots[slot] = o.second;
         }
 
     }
 
+    AlgorithmStats& AlgorithmInfo::statistics() const
+    {
+        return *m_stats;
+    }
+
+    namespace
+    {
+        template <typename ArgumentPtr, typename NamePtr>
+        v8::Local<v8::String> PropertyName(const std::vector<ArgumentPtr>& arguments, std::vector<NamePtr>& names, size_t slot)
+        {
+            if (names.empty())
+            {
+                names.resize(arguments.size());
+
+                // Handles live as long as the algorithm registry, that is until the addon is unloaded
+                for (size_t i = 0; i < arguments.size(); i++)
+                    names[i].reset(new Nan::Persistent<v8::String>(Nan::New<v8::String>(arguments[i]->name()).ToLocalChecked()));
+            }
+
+            return Nan::New(*names[slot]);
+        }
+    }
+
+    v8::Local<v8::String> AlgorithmInfo::inputPropertyName(size_t slot) const
+    {
+        return PropertyName(m_inputSlots, m_inputNames, slot);
+    }
+
+    v8::Local<v8::String> AlgorithmInfo::outputPropertyName(size_t slot) const
+    {
+        return PropertyName(m_outputSlots, m_outputNames, slot);
+    }
+
     std::map<std::string, AlgorithmInfoPtr> AlgorithmInfo::m_algorithms;
 
     void AlgorithmInfo::Register(AlgorithmInfo * info)
@@ -10,6 +10,7 @@
 #include <nan.h>
 
 #include "framework/Argument.hpp"
+#include "framework/AlgorithmStats.hpp"
 #include "framework/marshal/marshal.hpp"
 
 namespace cloudcv
@@ -35,9 +36,32 @@ namespace cloudcv
         {
             return m_outputParams;
         }
+
+        //! Input arguments ordered by slot
+        inline const std::vector<InputArgumentPtr>& inputSlots() const
+        {
+            return m_inputSlots;
+        }
+
+        //! Output arguments ordered by slot
+        inline const std::vector<OutputArgumentPtr>& outputSlots() const
+        {
+            return m_outputSlots;
+        }
+
+        /**
+         * @brief Internalized JS property names of arguments, indexed by slot.
+         *        Created once on first use and kept for the lifetime of the isolate,
+         *        so binding a request does not allocate name strings. V8 thread only.
+         */
+        v8::Local<v8::String> inputPropertyName(size_t slot) const;
+        v8::Local<v8::String> outputPropertyName(size_t slot) const;
         
         virtual std::shared_ptr<Algorithm> create() const = 0;
 
+        //! Counters and latency histograms of this algorithm
+        AlgorithmStats& statistics() const;
+
         static void Register(AlgorithmInfo * info);
 
         static const std::map<std::string, AlgorithmInfoPtr>& Get();
@@ -53,6 +77,14 @@ namespace cloudcv
         std::string                              m_name;
         std::map<std::string, InputArgumentPtr>  m_inputParams;
         std::map<std::string, OutputArgumentPtr> m_outputParams;
+        std::vector<InputArgumentPtr>            m_inputSlots;
+        std::vector<OutputArgumentPtr>           m_outputSlots;
+        std::shared_ptr<AlgorithmStats>          m_stats;
+
+        typedef std::unique_ptr< Nan::Persistent<v8::String> > PropertyNamePtr;
+
+        mutable std::vector<PropertyNamePtr>     m_inputNames;
+        mutable std::vector<PropertyNamePtr>     m_outputNames;
 
         static std::map<std::string, AlgorithmInfoPtr> m_algorithms;
     };
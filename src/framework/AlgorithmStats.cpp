@@ -0,0 +1,239 @@
+/**********************************************************************************
+* CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+*                    This project lets you to quickly prototype a REST API
+*                    in a Node.js for a image processing service written in C++.
+*
+* Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+*
+* More information:
+*  - https://cloudcv.io
+*  - http://computer-vision-talks.com
+*
+**********************************************************************************/
+#include "framework/AlgorithmStats.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace cloudcv
+{
+    namespace
+    {
+        const int SubBucketBits = 3; // log2(LatencyHistogram::SubBuckets)
+
+        int HighestBit(uint64_t value)
+        {
+            int bit = 0;
+            while (value >>= 1)
+                bit++;
+            return bit;
+        }
+
+        void AtomicMin(std::atomic<uint64_t>& target, uint64_t value)
+        {
+            uint64_t current = target.load(std::memory_order_relaxed);
+            while (value < current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed))
+            {
+            }
+        }
+
+        void AtomicMax(std::atomic<uint64_t>& target, uint64_t value)
+        {
+            uint64_t current = target.load(std::memory_order_relaxed);
+            while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed))
+            {
+            }
+        }
+    }
+
+    LatencyHistogram::LatencyHistogram()
+    {
+        reset();
+    }
+
+    size_t LatencyHistogram::BucketIndex(uint64_t microseconds)
+    {
+        if (microseconds < 2 * SubBuckets)
+            return static_cast<size_t>(microseconds);
+
+        const int exponent = HighestBit(microseconds);
+        if (exponent >= static_cast<int>(MaxExponent))
+            return BucketCount - 1;
+
+        const size_t subBucket = (microseconds >> (exponent - SubBucketBits)) & (SubBuckets - 1);
+        return 2 * SubBuckets + (exponent - SubBucketBits - 1) * SubBuckets + subBucket;
+    }
+
+    uint64_t LatencyHistogram::BucketLowerBound(size_t index)
+    {
+        if (index < 2 * SubBuckets)
+            return index;
+
+        const size_t exponent = (index - 2 * SubBuckets) / SubBuckets + SubBucketBits + 1;
+        const size_t subBucket = (index - 2 * SubBuckets) % SubBuckets;
+        return static_cast<uint64_t>(SubBuckets + subBucket) << (exponent - SubBucketBits);
+    }
+
+    uint64_t LatencyHistogram::BucketUpperBound(size_t index)
+    {
+        if (index < 2 * SubBuckets)
+            return index;
+
+        const size_t exponent = (index - 2 * SubBuckets) / SubBuckets + SubBucketBits + 1;
+        return BucketLowerBound(index) + (static_cast<uint64_t>(1) << (exponent - SubBucketBits)) - 1;
+    }
+
+    void LatencyHistogram::record(double milliseconds)
+    {
+        const uint64_t microseconds = static_cast<uint64_t>(std::max(0.0, milliseconds) * 1000.0 + 0.5);
+
+        m_buckets[BucketIndex(microseconds)].fetch_add(1, std::memory_order_relaxed);
+        m_sum.fetch_add(microseconds, std::memory_order_relaxed);
+        AtomicMin(m_min, microseconds);
+        AtomicMax(m_max, microseconds);
+    }
+
+    double LatencyHistogram::percentile(const uint64_t * counts, uint64_t total, double fraction, uint64_t maxValue) const
+    {
+        const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(fraction * total)));
+        uint64_t seen = 0;
+
+        for (size_t i = 0; i < BucketCount; i++)
+        {
+            seen += counts[i];
+            if (seen >= rank)
+            {
+                // Middle of the bucket, but never above the largest recorded value
+                const uint64_t value = (BucketLowerBound(i) + BucketUpperBound(i)) / 2;
+                return std::min(value, maxValue) / 1000.0;
+            }
+        }
+
+        return maxValue / 1000.0;
+    }
+
+    LatencyHistogram::Snapshot LatencyHistogram::snapshot() const
+    {
+        uint64_t counts[BucketCount];
+        uint64_t total = 0;
+
+        // Count is taken from the buckets so percentiles are consistent with it
+        for (size_t i = 0; i < BucketCount; i++)
+        {
+            counts[i] = m_buckets[i].load(std::memory_order_relaxed);
+            total += counts[i];
+        }
+
+        Snapshot snapshot = Snapshot();
+        snapshot.count = total;
+
+        if (total == 0)
+            return snapshot;
+
+        const uint64_t maxValue = m_max.load(std::memory_order_relaxed);
+
+        snapshot.minMs  = m_min.load(std::memory_order_relaxed) / 1000.0;
+        snapshot.maxMs  = maxValue / 1000.0;
+        snapshot.meanMs = m_sum.load(std::memory_order_relaxed) / 1000.0 / total;
+        snapshot.p50Ms  = percentile(counts, total, 0.5,   maxValue);
+        snapshot.p90Ms  = percentile(counts, total, 0.9,   maxValue);
+        snapshot.p99Ms  = percentile(counts, total, 0.99,  maxValue);
+        snapshot.p999Ms = percentile(counts, total, 0.999, maxValue);
+
+        return snapshot;
+    }
+
+    LatencyHistogram::Cumulative LatencyHistogram::cumulative(const std::vector<double>& boundsMs) const
+    {
+        Cumulative result;
+        result.counts.resize(boundsMs.size(), 0);
+        result.count = 0;
+
+        size_t bound = 0;
+
+        for (size_t i = 0; i < BucketCount; i++)
+        {
+            const uint64_t count = m_buckets[i].load(std::memory_order_relaxed);
+            const double upperMs = BucketUpperBound(i) / 1000.0;
+
+            while (bound < boundsMs.size() && boundsMs[bound] < upperMs)
+                result.counts[bound++] = result.count;
+
+            result.count += count;
+        }
+
+        while (bound < boundsMs.size())
+            result.counts[bound++] = result.count;
+
+        result.sumMs = m_sum.load(std::memory_order_relaxed) / 1000.0;
+        return result;
+    }
+
+    void LatencyHistogram::reset()
+    {
+        for (size_t i = 0; i < BucketCount; i++)
+            m_buckets[i].store(0, std::memory_order_relaxed);
+
+        m_sum.store(0, std::memory_order_relaxed);
+        m_min.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+        m_max.store(0, std::memory_order_relaxed);
+    }
+
+    AlgorithmStats::Sample::Sample(double queueTimeMs, size_t bytesIn)
+        : queueTimeMs(queueTimeMs)
+        , executionTimeMs(0)
+        , bytesIn(bytesIn)
+        , bytesOut(0)
+        , failed(false)
+        , cancelled(false)
+    {
+    }
+
+    AlgorithmStats::AlgorithmStats()
+    {
+        reset();
+    }
+
+    void AlgorithmStats::record(const Sample& sample)
+    {
+        m_calls.fetch_add(1, std::memory_order_relaxed);
+        m_bytesIn.fetch_add(sample.bytesIn, std::memory_order_relaxed);
+        m_bytesOut.fetch_add(sample.bytesOut, std::memory_order_relaxed);
+
+        if (sample.cancelled)
+            m_cancelled.fetch_add(1, std::memory_order_relaxed);
+        else if (sample.failed)
+            m_errors.fetch_add(1, std::memory_order_relaxed);
+
+        m_queueTime.record(sample.queueTimeMs);
+        m_executionTime.record(sample.executionTimeMs);
+    }
+
+    AlgorithmStats::Snapshot AlgorithmStats::snapshot() const
+    {
+        Snapshot snapshot;
+
+        snapshot.calls         = m_calls.load(std::memory_order_relaxed);
+        snapshot.errors        = m_errors.load(std::memory_order_relaxed);
+        snapshot.cancelled     = m_cancelled.load(std::memory_order_relaxed);
+        snapshot.bytesIn       = m_bytesIn.load(std::memory_order_relaxed);
+        snapshot.bytesOut      = m_bytesOut.load(std::memory_order_relaxed);
+        snapshot.queueTime     = m_queueTime.snapshot();
+        snapshot.executionTime = m_executionTime.snapshot();
+
+        return snapshot;
+    }
+
+    void AlgorithmStats::reset()
+    {
+        m_calls.store(0, std::memory_order_relaxed);
+        m_errors.store(0, std::memory_order_relaxed);
+        m_cancelled.store(0, std::memory_order_relaxed);
+        m_bytesIn.store(0, std::memory_order_relaxed);
+        m_bytesOut.store(0, std::memory_order_relaxed);
+
+        m_queueTime.reset();
+        m_executionTime.reset();
+    }
+}
@@ -0,0 +1,193 @@
+/**********************************************************************************
+* CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+*                    This project lets you to quickly prototype a REST API
+*                    in a Node.js for a image processing service written in C++.
+*
+* Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+*
+* More information:
+*  - https://cloudcv.io
+*  - http://computer-vision-talks.com
+*
+**********************************************************************************/
+#pragma once
+
+#include <nan.h>
+#include <nan-marshal.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cloudcv
+{
+    /**
+     * @brief   Lock-free latency histogram with bounded relative error.
+     * @details Latencies are recorded in microseconds into log-linear buckets: values 
+     *          below 16us are exact, larger ones fall into one of eight sub-buckets per 
+     *          power of two, so any reported percentile is within 12.5% of the real value. 
+     *          Recording is a few relaxed atomic increments and may be done from any thread.
+     */
+    class LatencyHistogram
+    {
+    public:
+        struct Snapshot
+        {
+            uint64_t count;
+            double   minMs;
+            double   meanMs;
+            double   maxMs;
+            double   p50Ms;
+            double   p90Ms;
+            double   p99Ms;
+            double   p999Ms;
+        };
+
+        //! Cumulative counts at given bounds, as exported in Prometheus histograms
+        struct Cumulative
+        {
+            std::vector<uint64_t> counts;
+            uint64_t              count;
+            double                sumMs;
+        };
+
+        LatencyHistogram();
+
+        void record(double milliseconds);
+
+        Snapshot snapshot() const;
+
+        /**
+         * @brief Number of values not greater than each of ascending bounds. 
+         *        A bucket is counted once all of it is within the bound, so a count 
+         *        may miss values of one bucket that straddles the bound.
+         */
+        Cumulative cumulative(const std::vector<double>& boundsMs) const;
+
+        //! Not atomic with respect to concurrent record() calls
+        void reset();
+
+        static const size_t SubBuckets  = 8;
+        static const size_t MaxExponent = 40; // ~12 days in microseconds
+        static const size_t BucketCount = 2 * SubBuckets + (MaxExponent - 4) * SubBuckets;
+
+    private:
+        static size_t BucketIndex(uint64_t microseconds);
+        static uint64_t BucketLowerBound(size_t index);
+        static uint64_t BucketUpperBound(size_t index);
+
+        double percentile(const uint64_t * counts, uint64_t total, double fraction, uint64_t maxValue) const;
+
+        std::atomic<uint64_t> m_buckets[BucketCount];
+        std::atomic<uint64_t> m_sum;
+        std::atomic<uint64_t> m_min;
+        std::atomic<uint64_t> m_max;
+    };
+
+    /**
+     * @brief Counters and latency histograms of one algorithm. 
+     *        Owned by AlgorithmInfo; updated lock-free from worker threads.
+     */
+    class AlgorithmStats
+    {
+    public:
+        //! Measurements of a single algorithm invocation
+        struct Sample
+        {
+            Sample(double queueTimeMs, size_t bytesIn);
+
+            //! Time the job waited in the thread pool queue
+            double queueTimeMs;
+
+            //! Time spent in Algorithm::process
+            double executionTimeMs;
+
+            size_t bytesIn;
+            size_t bytesOut;
+
+            bool   failed;
+            bool   cancelled;
+        };
+
+        struct Snapshot
+        {
+            uint64_t calls;
+            uint64_t errors;
+            uint64_t cancelled;
+            uint64_t bytesIn;
+            uint64_t bytesOut;
+
+            LatencyHistogram::Snapshot queueTime;
+            LatencyHistogram::Snapshot executionTime;
+        };
+
+        AlgorithmStats();
+
+        void record(const Sample& sample);
+
+        Snapshot snapshot() const;
+
+        void reset();
+
+        const LatencyHistogram& queueTime() const { return m_queueTime; }
+        const LatencyHistogram& executionTime() const { return m_executionTime; }
+
+    private:
+        std::atomic<uint64_t> m_calls;
+        std::atomic<uint64_t> m_errors;
+        std::atomic<uint64_t> m_cancelled;
+        std::atomic<uint64_t> m_bytesIn;
+        std::atomic<uint64_t> m_bytesOut;
+
+        LatencyHistogram      m_queueTime;
+        LatencyHistogram      m_executionTime;
+    };
+}
+
+namespace Nan
+{
+    namespace marshal
+    {
+        using namespace cloudcv;
+
+        template<>
+        struct Serializer<LatencyHistogram::Snapshot>
+        {
+            template<typename InputArchive>
+            static inline void load(InputArchive& ar, LatencyHistogram::Snapshot& val) = delete;
+
+            template<typename OutputArchive>
+            static inline void save(OutputArchive& ar, const LatencyHistogram::Snapshot& val)
+            {
+                ar & make_nvp("count", static_cast<double>(val.count));
+                ar & make_nvp("min",   val.minMs);
+                ar & make_nvp("mean",  val.meanMs);
+                ar & make_nvp("max",   val.maxMs);
+                ar & make_nvp("p50",   val.p50Ms);
+                ar & make_nvp("p90",   val.p90Ms);
+                ar & make_nvp("p99",   val.p99Ms);
+                ar & make_nvp("p999",  val.p999Ms);
+            }
+        };
+
+        template<>
+        struct Serializer<AlgorithmStats::Snapshot>
+        {
+            template<typename InputArchive>
+            static inline void load(InputArchive& ar, AlgorithmStats::Snapshot& val) = delete;
+
+            template<typename OutputArchive>
+            static inline void save(OutputArchive& ar, const AlgorithmStats::Snapshot& val)
+            {
+                ar & make_nvp("calls",         static_cast<double>(val.calls));
+                ar & make_nvp("errors",        static_cast<double>(val.errors));
+                ar & make_nvp("cancelled",     static_cast<double>(val.cancelled));
+                ar & make_nvp("bytesIn",       static_cast<double>(val.bytesIn));
+                ar & make_nvp("bytesOut",      static_cast<double>(val.bytesOut));
+                ar & make_nvp("queueTime",     val.queueTime);
+                ar & make_nvp("executionTime", val.executionTime);
+            }
+        };
+    }
+}
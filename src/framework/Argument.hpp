@@ -11,7 +11,10 @@
 #include <nan-marshal.h>
 #include <type_traits>
 
+#include "framework/AlgorithmExceptions.hpp"
 #include "framework/ImageView.hpp"
+#include "framework/ContentHash.hpp"
+#include "framework/TrafficRecorder.hpp"
 #include "framework/marshal/opencv.hpp"
 
 #pragma once
@@ -54,6 +57,123 @@ namespace cloudcv
     };
      
 
+    /**
+     * @brief Estimates memory held by argument value.
+     */
+    template <class T> struct MemoryEstimate
+    {
+        static inline size_t of(const T& /*value*/) { return sizeof(T); }
+    };
+
+    template <class T> struct MemoryEstimate< std::vector<T> >
+    {
+        static inline size_t of(const std::vector<T>& value) { return value.capacity() * sizeof(T); }
+    };
+
+    template <> struct MemoryEstimate<ImageView>
+    {
+        static inline size_t of(const ImageView& value) { return value.memoryEstimate(); }
+    };
+
+    /**
+     * @brief Mixes argument value into a hash that identifies request.
+     *        Returns false for values that cannot be hashed.
+     */
+    template <class T, class Enable = void> struct ValueHash
+    {
+        static inline bool combine(const T& /*value*/, uint64_t& /*seed*/) { return false; }
+    };
+
+    template <class T> struct ValueHash<T, typename std::enable_if<std::is_arithmetic<T>::value>::type>
+    {
+        static inline bool combine(const T& value, uint64_t& seed) 
+        { 
+            seed = HashCombine(seed, ContentHash(&value, sizeof(T)));
+            return true;
+        }
+    };
+
+    template <> struct ValueHash<std::string>
+    {
+        static inline bool combine(const std::string& value, uint64_t& seed) 
+        { 
+            seed = HashCombine(seed, ContentHash(value.data(), value.size()));
+            return true;
+        }
+    };
+
+    template <> struct ValueHash<ImageView>
+    {
+        static inline bool combine(const ImageView& value, uint64_t& seed) 
+        { 
+            uint64_t key;
+            if (!value.contentKey(key))
+                return false;
+
+            seed = HashCombine(seed, key);
+            return true;
+        }
+    };
+
+    /**
+     * @brief Compares argument values of two requests whose hashes matched.
+     *        Returns false for values that cannot be compared.
+     */
+    template <class T, class Enable = void> struct ValueEquals
+    {
+        static inline bool compare(const T& /*a*/, const T& /*b*/) { return false; }
+    };
+
+    template <class T> struct ValueEquals<T, typename std::enable_if<std::is_arithmetic<T>::value>::type>
+    {
+        static inline bool compare(const T& a, const T& b) { return a == b; }
+    };
+
+    template <> struct ValueEquals<std::string>
+    {
+        static inline bool compare(const std::string& a, const std::string& b) { return a == b; }
+    };
+
+    template <> struct ValueEquals<ImageView>
+    {
+        static inline bool compare(const ImageView& a, const ImageView& b) { return a.sameContent(b); }
+    };
+
+    /**
+     * @brief Writes argument value into traffic log record.
+     *        Returns false for values that cannot be recorded.
+     */
+    template <class T, class Enable = void> struct ValueRecord
+    {
+        static inline bool write(const std::string& /*name*/, const T& /*value*/, TrafficRecordWriter& /*writer*/) { return false; }
+    };
+
+    template <class T> struct ValueRecord<T, typename std::enable_if<std::is_arithmetic<T>::value>::type>
+    {
+        static inline bool write(const std::string& name, const T& value, TrafficRecordWriter& writer) 
+        { 
+            writer.number(name, static_cast<double>(value));
+            return true;
+        }
+    };
+
+    template <> struct ValueRecord<std::string>
+    {
+        static inline bool write(const std::string& name, const std::string& value, TrafficRecordWriter& writer) 
+        { 
+            writer.string(name, value);
+            return true;
+        }
+    };
+
+    template <> struct ValueRecord<ImageView>
+    {
+        static inline bool write(const std::string& name, const ImageView& value, TrafficRecordWriter& writer) 
+        { 
+            return writer.image(name, value);
+        }
+    };
+
     class InputArgument;
     class OutputArgument;
     class ParameterBinding;
@@ -66,6 +186,22 @@ namespace cloudcv
         virtual ~ParameterBinding() = default;
 
         virtual v8::Local<v8::Value> marshalFromNative() const = 0;
+
+        //! Marshals value as packed typed array if value type supports it, 
+        //! otherwise the same way as marshalFromNative.
+        virtual v8::Local<v8::Value> marshalPackedFromNative() const = 0;
+
+        //! Estimated amount of memory held by bound value
+        virtual size_t memoryEstimate() const = 0;
+
+        //! Mixes bound value into seed. Returns false if value cannot be hashed.
+        virtual bool hash(uint64_t& seed) const = 0;
+
+        //! True if other binding holds the same value. V8 thread only.
+        virtual bool equals(const ParameterBinding& other) const = 0;
+
+        //! Writes bound value into traffic log. Returns false if value cannot be recorded.
+        virtual bool record(const std::string& name, TrafficRecordWriter& writer) const = 0;
     };
 
     template <class T>
@@ -102,6 +238,32 @@ namespace cloudcv
             return scope.Escape(Nan::Marshal(val));
         }
 
+        inline v8::Local<v8::Value> marshalPackedFromNative() const override
+        {
+            Nan::EscapableHandleScope scope;
+            return scope.Escape(PackedSerializer<T>::save(get()));
+        }
+
+        inline size_t memoryEstimate() const override
+        {
+            return MemoryEstimate<T>::of(get());
+        }
+
+        inline bool hash(uint64_t& seed) const override
+        {
+            return ValueHash<T>::combine(get(), seed);
+        }
+
+        inline bool equals(const ParameterBinding& other) const override
+        {
+            return other.type() == type() && ValueEquals<T>::compare(get(), static_cast<const TypedBinding<T>&>(other).get());
+        }
+
+        inline bool record(const std::string& name, TrafficRecordWriter& writer) const override
+        {
+            return ValueRecord<T>::write(name, get(), writer);
+        }
+
     private:
         T           m_value;
     };
@@ -110,9 +272,73 @@ namespace cloudcv
     template<typename T>
     std::shared_ptr<ParameterBinding> wrap_as_bind(const T& value)
     {
-        return std::shared_ptr<ParameterBinding>(new TypedBinding<T>(value));
+        return std::make_shared< TypedBinding<T> >(value);
     }
 
+    typedef std::shared_ptr<ParameterBinding> ParameterBindingPtr;
+
+    /**
+     * @brief   Bindings of algorithm arguments stored by slot index.
+     * @details Slots are compile-time constants of argument tags, verified when 
+     *          algorithm is registered. Binding of a slot is always created by the 
+     *          argument registered for it, so release builds access it unchecked; 
+     *          debug builds verify the slot and the type of the binding.
+     */
+    class ArgumentBindings
+    {
+    public:
+        ArgumentBindings()
+        {
+        }
+
+        explicit ArgumentBindings(size_t count)
+            : m_bindings(count)
+        {
+        }
+
+        inline size_t size() const
+        {
+            return m_bindings.size();
+        }
+
+        inline const ParameterBindingPtr& operator[](size_t slot) const
+        {
+            return m_bindings[slot];
+        }
+
+        inline ParameterBindingPtr& operator[](size_t slot)
+        {
+            return m_bindings[slot];
+        }
+
+        template <typename T>
+        inline T& value(size_t slot) const
+        {
+#if defined(DEBUG) || defined(_DEBUG)
+            // Catches tags that were never registered with the algorithm
+            if (slot >= m_bindings.size() || !m_bindings[slot])
+                throw MissingInputArgumentException("slot " + std::to_string(slot));
+
+            if (m_bindings[slot]->type() != TypedBinding<T>::static_type())
+                throw ArgumentTypeMismatchException("slot " + std::to_string(slot), m_bindings[slot]->type(), TypedBinding<T>::static_type());
+#endif
+            return static_cast<TypedBinding<T>*>(m_bindings[slot].get())->get();
+        }
+
+        inline std::vector<ParameterBindingPtr>::const_iterator begin() const
+        {
+            return m_bindings.begin();
+        }
+
+        inline std::vector<ParameterBindingPtr>::const_iterator end() const
+        {
+            return m_bindings.end();
+        }
+
+    private:
+        std::vector<ParameterBindingPtr> m_bindings;
+    };
+
 
     class InputArgument
     {
@@ -121,22 +347,45 @@ namespace cloudcv
 
         virtual std::shared_ptr<ParameterBinding> bind(v8::Local<v8::Value> value) = 0;
 
+        /**
+         * @brief Binds value that was already bound to another argument of the same type.
+         *        By default value is bound again, so argument validation applies.
+         */
+        virtual std::shared_ptr<ParameterBinding> bindShared(std::shared_ptr<ParameterBinding> /*bound*/, v8::Local<v8::Value> value)
+        {
+            return bind(value);
+        }
+
+        /**
+         * @brief Binds value the argument takes when it is omitted, without touching V8.
+         *        Returns null for required arguments.
+         */
+        virtual std::shared_ptr<ParameterBinding> bindDefault() const
+        {
+            return nullptr;
+        }
+
         const std::string& name() const { return m_name; }
         const std::string& type() const { return m_type; }
 
+        //! Index of the argument in ArgumentBindings
+        size_t slot() const { return m_slot; }
+
         //! Serialize argument information
         virtual void serialize(Nan::marshal::SaveArchive& value) const = 0;
 
     protected:
-        InputArgument(const std::string& name, const std::string& type)
+        InputArgument(const std::string& name, const std::string& type, size_t slot)
             : m_name(name)
             , m_type(type)
+            , m_slot(slot)
         {
         }
 
     private:
         std::string m_name;
         std::string m_type;
+        size_t      m_slot;
     };
 
     typedef std::shared_ptr<InputArgument> InputArgumentPtr;
@@ -152,18 +401,23 @@ namespace cloudcv
         const std::string& name() const { return m_name; }
         const std::string& type() const { return m_type; }
 
+        //! Index of the argument in ArgumentBindings
+        size_t slot() const { return m_slot; }
+
         virtual void serialize(Nan::marshal::SaveArchive& value) const = 0;
 
     protected:
-        OutputArgument(const std::string& name, const std::string& type)
+        OutputArgument(const std::string& name, const std::string& type, size_t slot)
             : m_name(name)
             , m_type(type)
+            , m_slot(slot)
         {
         }
 
     private:
         std::string m_name;
         std::string m_type;
+        size_t      m_slot;
     };
 
     typedef std::shared_ptr<OutputArgument> OutputArgumentPtr;
@@ -172,9 +426,9 @@ namespace cloudcv
     class TypedOutputArgument : public OutputArgument
     {
     public:
-        static std::pair<std::string, OutputArgumentPtr>  Create(const char * name)
+        static std::pair<std::string, OutputArgumentPtr>  Create(const char * name, size_t slot)
         {
-            return std::make_pair(name, std::shared_ptr<OutputArgument>(new TypedOutputArgument<T>(name)));
+            return std::make_pair(name, std::shared_ptr<OutputArgument>(new TypedOutputArgument<T>(name, slot)));
         }
 
         virtual std::shared_ptr<ParameterBinding> bind() override
@@ -185,6 +439,7 @@ namespace cloudcv
         virtual void serialize(Nan::marshal::SaveArchive& value) const override
         {
             value & Nan::marshal::make_nvp("name", name());
+            value & Nan::marshal::make_nvp("slot", static_cast<double>(slot()));
 
             using namespace std;
 
@@ -208,8 +463,8 @@ namespace cloudcv
         }
 
     protected:
-        TypedOutputArgument(const char * name)
-            : OutputArgument(name, typeid(T).name())
+        TypedOutputArgument(const char * name, size_t slot)
+            : OutputArgument(name, typeid(T).name(), slot)
         {
         }
     };
@@ -220,9 +475,9 @@ namespace cloudcv
     class RequiredArgument : public InputArgument
     {
     public:
-        static inline std::pair<std::string, InputArgumentPtr> Create(const char * name)
+        static inline std::pair<std::string, InputArgumentPtr> Create(const char * name, size_t slot)
         {
-            return std::make_pair(name, std::shared_ptr<InputArgument>(new RequiredArgument<T>(name)));
+            return std::make_pair(name, std::shared_ptr<InputArgument>(new RequiredArgument<T>(name, slot)));
         }
 
         std::shared_ptr<ParameterBinding> bind(v8::Local<v8::Value> value) override
@@ -235,16 +490,22 @@ namespace cloudcv
             return wrap_as_bind(Nan::Marshal<T>(value));
         }
 
+        std::shared_ptr<ParameterBinding> bindShared(std::shared_ptr<ParameterBinding> bound, v8::Local<v8::Value> /*value*/) override
+        {
+            return bound;
+        }
+
         //! Serialize argument information
         virtual void serialize(Nan::marshal::SaveArchive& value) const override
         {
             value & Nan::marshal::make_nvp("name", name());
+            value & Nan::marshal::make_nvp("slot", static_cast<double>(slot()));
             value & Nan::marshal::make_nvp("type", type());
         }
 
     protected:
-        inline RequiredArgument(const char * name)
-            : InputArgument(name, typeid(T).name())
+        inline RequiredArgument(const char * name, size_t slot)
+            : InputArgument(name, typeid(T).name(), slot)
         {
         }
     };
@@ -254,9 +515,9 @@ namespace cloudcv
     class RangedArgument : public InputArgument
     {
     public:
-        static inline std::pair<std::string, InputArgumentPtr> Create(const char * name, T minValue, T defaultValue, T maxValue)
+        static inline std::pair<std::string, InputArgumentPtr> Create(const char * name, size_t slot, T minValue, T defaultValue, T maxValue)
         {
-            return std::make_pair(name, std::shared_ptr<InputArgument>(new RangedArgument<T>(name, minValue, defaultValue, maxValue)));
+            return std::make_pair(name, std::shared_ptr<InputArgument>(new RangedArgument<T>(name, slot, minValue, defaultValue, maxValue)));
         }
 
         std::shared_ptr<ParameterBinding> bind(v8::Local<v8::Value> value) override
@@ -269,12 +530,18 @@ namespace cloudcv
             return wrap_as_bind(validate(Nan::Marshal<T>(value)));
         }
 
+        std::shared_ptr<ParameterBinding> bindDefault() const override
+        {
+            return wrap_as_bind(m_default);
+        }
+
         //! Serialize argument information
         virtual void serialize(Nan::marshal::SaveArchive& value) const override
         {
             using namespace Nan::marshal;
 
             value & make_nvp("name", name());
+            value & make_nvp("slot", static_cast<double>(slot()));
             value & make_nvp("type", type());
 
             value & make_nvp("min", m_min);
@@ -283,8 +550,8 @@ namespace cloudcv
         }
 
     protected:
-        inline RangedArgument(const char * name, T minValue, T defaultValue, T maxValue)
-            : InputArgument(name, typeid(T).name())
+        inline RangedArgument(const char * name, size_t slot, T minValue, T defaultValue, T maxValue)
+            : InputArgument(name, typeid(T).name(), slot)
             , m_min(minValue)
             , m_max(maxValue)
             , m_default(defaultValue)
@@ -308,21 +575,87 @@ namespace cloudcv
         T           m_default;
     };
 
+    /**
+     * @brief Required image argument that carries decode hints of the algorithm.
+     */
+    class ImageArgument : public InputArgument
+    {
+    public:
+        static inline std::pair<std::string, InputArgumentPtr> Create(const char * name, size_t slot, const DecodeHints& hints)
+        {
+            return std::make_pair(name, std::shared_ptr<InputArgument>(new ImageArgument(name, slot, hints)));
+        }
+
+        std::shared_ptr<ParameterBinding> bind(v8::Local<v8::Value> value) override
+        {
+            if (value->IsUndefined() || value->IsNull())
+            {
+                throw ArgumentBindException(name(), "Missing required argument \"" + name() + "\"");
+            }
+
+            return bindImage(Nan::Marshal<ImageView>(value));
+        }
+
+        //! Binds image created natively, e.g. by the benchmark runner
+        std::shared_ptr<ParameterBinding> bindImage(ImageView image) const
+        {
+            image.setDecodeHints(m_hints);
+            return wrap_as_bind(image);
+        }
+
+        //! Shares the image, so it is decoded once with hints merged from all consumers
+        std::shared_ptr<ParameterBinding> bindShared(std::shared_ptr<ParameterBinding> bound, v8::Local<v8::Value> /*value*/) override
+        {
+            static_cast<TypedBinding<ImageView>*>(bound.get())->get().setDecodeHints(m_hints);
+            return bound;
+        }
+
+        //! Serialize argument information
+        virtual void serialize(Nan::marshal::SaveArchive& value) const override
+        {
+            using namespace Nan::marshal;
+
+            value & make_nvp("name", name());
+            value & make_nvp("slot", static_cast<double>(slot()));
+            value & make_nvp("type", type());
+
+            value & make_nvp("colorMode", m_hints.colorMode);
+            value & make_nvp("maxResolution", m_hints.maxResolution);
+        }
+
+    protected:
+        inline ImageArgument(const char * name, size_t slot, const DecodeHints& hints)
+            : InputArgument(name, typeid(ImageView).name(), slot)
+            , m_hints(hints)
+        {
+        }
+
+    private:
+        DecodeHints m_hints;
+    };
+
     template <typename T>
     static inline std::pair<std::string, InputArgumentPtr> inputArgument()
     {
-        return RequiredArgument<typename T::type>::Create(T::name());
+        return RequiredArgument<typename T::type>::Create(T::name(), T::slot);
     }
 
     template <typename T>
     static inline std::pair<std::string, InputArgumentPtr> inputArgument(typename T::type minValue, typename T::type defaultValue, typename T::type maxValue)
     {
-        return RangedArgument<typename T::type>::Create(T::name(), minValue, defaultValue, maxValue);
+        return RangedArgument<typename T::type>::Create(T::name(), T::slot, minValue, defaultValue, maxValue);
+    }
+
+    template <typename T>
+    static inline std::pair<std::string, InputArgumentPtr> inputArgument(const DecodeHints& hints)
+    {
+        static_assert(std::is_same<typename T::type, ImageView>::value, "Decode hints can be used only for image arguments");
+        return ImageArgument::Create(T::name(), T::slot, hints);
     }
 
     template <typename T>
     static inline std::pair<std::string, OutputArgumentPtr> outputArgument()
     {
-        return TypedOutputArgument<typename T::type>::Create(T::name());
+        return TypedOutputArgument<typename T::type>::Create(T::name(), T::slot);
     }
 }
\ No newline at end of file
@@ -0,0 +1,280 @@
+/**********************************************************************************
+* CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+*                    This project lets you to quickly prototype a REST API
+*                    in a Node.js for a image processing service written in C++.
+*
+* Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+*
+* More information:
+*  - https://cloudcv.io
+*  - http://computer-vision-talks.com
+*
+**********************************************************************************/
+#include "framework/Benchmark.hpp"
+#include "framework/Algorithm.hpp"
+#include "framework/AlgorithmInfo.hpp"
+#include "framework/NativeMemory.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+
+namespace cloudcv
+{
+    namespace
+    {
+        uint64_t Now()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        /**
+         * Deterministic image with straight edges on a noisy background, so that
+         * line and feature detectors have work to do and runs are comparable.
+         */
+        cv::Mat SyntheticImage(cv::Size size, int channels)
+        {
+            cv::RNG rng(0x5EED);
+            cv::Mat image(size, CV_8UC(channels), cv::Scalar::all(96));
+
+            const int shapes = 16;
+            for (int i = 0; i < shapes; i++)
+            {
+                cv::Point a(rng.uniform(0, size.width), rng.uniform(0, size.height));
+                cv::Point b(rng.uniform(0, size.width), rng.uniform(0, size.height));
+                cv::Scalar color(rng.uniform(0, 256), rng.uniform(0, 256), rng.uniform(0, 256));
+
+                cv::line(image, a, b, color, rng.uniform(1, 4));
+                cv::rectangle(image, cv::Rect(a, b), color, 1);
+            }
+
+            cv::Mat noise(size, image.type());
+            rng.fill(noise, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(16));
+            image += noise;
+
+            return image;
+        }
+
+        //! Returns name of the first input that cannot be bound natively, empty on success
+        std::string BindInputs(const AlgorithmInfo& info, const cv::Mat& image, ArgumentBindings& inArgs, ArgumentBindings& outArgs)
+        {
+            inArgs = ArgumentBindings(info.inputSlots().size());
+            outArgs = ArgumentBindings(info.outputSlots().size());
+
+            for (const auto& arg : info.inputSlots())
+            {
+                // A fresh view per call, so colour conversions are not served from the variant cache
+                const ImageArgument * imageArg = dynamic_cast<const ImageArgument*>(arg.get());
+                if (imageArg != nullptr)
+                    inArgs[arg->slot()] = imageArg->bindImage(ImageView::ViewForImage(image));
+                else
+                    inArgs[arg->slot()] = arg->bindDefault();
+
+                if (!inArgs[arg->slot()])
+                    return arg->name();
+            }
+
+            for (const auto& arg : info.outputSlots())
+            {
+                outArgs[arg->slot()] = arg->bind();
+            }
+
+            return std::string();
+        }
+
+        BenchmarkResult RunCase(const AlgorithmInfo& info, const std::string& input, const cv::Mat& image, const BenchmarkOptions& options)
+        {
+            BenchmarkResult result = BenchmarkResult();
+            result.algorithm = info.name();
+            result.input     = input;
+            result.width     = image.cols;
+            result.height    = image.rows;
+            result.channels  = image.channels();
+
+            AlgorithmPtr algorithm = info.create();
+            MemoryAccount memory(0);
+            std::vector<double> samples;
+
+            try
+            {
+                uint64_t started = 0;
+
+                for (int i = 0; ; i++)
+                {
+                    const bool warmup = i < options.warmupIterations;
+
+                    if (i == options.warmupIterations)
+                        started = Now();
+
+                    if (!warmup && static_cast<int>(samples.size()) >= std::max(1, options.minIterations) && (Now() - started) * 1e-6 >= options.minTimeMs)
+                        break;
+
+                    // Releases of outputs are charged too, so the account balances between calls
+                    ScopedMemoryAccount account(warmup ? nullptr : &memory);
+
+                    ArgumentBindings inArgs, outArgs;
+                    const std::string unbound = BindInputs(info, image, inArgs, outArgs);
+                    if (!unbound.empty())
+                    {
+                        result.error = "Argument \"" + unbound + "\" has no default value";
+                        return result;
+                    }
+
+                    const uint64_t start = Now();
+                    algorithm->process(inArgs, outArgs);
+                    const uint64_t elapsed = Now() - start;
+
+                    if (!warmup)
+                        samples.push_back(static_cast<double>(elapsed));
+                }
+            }
+            catch (std::exception& e)
+            {
+                result.error = e.what();
+                return result;
+            }
+
+            std::sort(samples.begin(), samples.end());
+
+            double total = 0;
+            for (double sample : samples)
+                total += sample;
+
+            const double pixels = static_cast<double>(image.total());
+
+            result.iterations = samples.size();
+            result.minNs      = samples.front();
+            result.medianNs   = samples[samples.size() / 2];
+            result.meanNs     = total / samples.size();
+            result.maxNs      = samples.back();
+
+            result.nsPerPixel          = result.medianNs / pixels;
+            result.megapixelsPerSecond = result.medianNs > 0 ? pixels * 1e3 / result.medianNs : 0;
+
+            result.allocationsPerCall    = static_cast<double>(memory.allocations()) / samples.size();
+            result.allocatedBytesPerCall = static_cast<double>(memory.allocatedBytes()) / samples.size();
+            result.peakBytes             = memory.peak();
+
+            return result;
+        }
+
+        void AppendEscaped(std::ostringstream& out, const std::string& text)
+        {
+            for (char c : text)
+            {
+                switch (c)
+                {
+                case '"':  out << "\\\""; break;
+                case '\\': out << "\\\\"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20)
+                        out << ' ';
+                    else
+                        out << c;
+                }
+            }
+        }
+    }
+
+    BenchmarkOptions::BenchmarkOptions()
+        : sizes{ cv::Size(320, 240), cv::Size(640, 480), cv::Size(1280, 720), cv::Size(1920, 1080) }
+        , channels{ 1, 3 }
+        , warmupIterations(3)
+        , minIterations(10)
+        , minTimeMs(250)
+    {
+    }
+
+    std::vector<BenchmarkResult> RunBenchmark(const BenchmarkOptions& options)
+    {
+        std::vector<BenchmarkResult> results;
+        std::vector< std::pair<std::string, cv::Mat> > inputs;
+
+        for (const auto& size : options.sizes)
+        {
+            for (int channels : options.channels)
+            {
+                inputs.push_back(std::make_pair(std::string("synthetic"), SyntheticImage(size, channels)));
+            }
+        }
+
+        for (const auto& path : options.images)
+        {
+            inputs.push_back(std::make_pair(path, cv::imread(path, cv::IMREAD_UNCHANGED)));
+        }
+
+        for (const auto& alg : AlgorithmInfo::Get())
+        {
+            if (!options.algorithms.empty() && std::find(options.algorithms.begin(), options.algorithms.end(), alg.first) == options.algorithms.end())
+                continue;
+
+            for (const auto& input : inputs)
+            {
+                if (input.second.empty())
+                {
+                    BenchmarkResult result = BenchmarkResult();
+                    result.algorithm = alg.first;
+                    result.input     = input.first;
+                    result.error     = "Cannot read image";
+                    results.push_back(result);
+                    continue;
+                }
+
+                results.push_back(RunCase(*alg.second, input.first, input.second, options));
+            }
+        }
+
+        return results;
+    }
+
+    std::string BenchmarkReportJson(const std::vector<BenchmarkResult>& results)
+    {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(3);
+
+        out << "{\"opencv\":\"" << CV_VERSION << "\""
+            << ",\"optimized\":" << (cv::useOptimized() ? "true" : "false")
+            << ",\"opencvThreads\":" << cv::getNumThreads()
+            << ",\"results\":[";
+
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            const BenchmarkResult& r = results[i];
+
+            if (i > 0)
+                out << ",";
+
+            out << "\n{\"algorithm\":\"";
+            AppendEscaped(out, r.algorithm);
+            out << "\",\"input\":\"";
+            AppendEscaped(out, r.input);
+            out << "\",\"width\":" << r.width
+                << ",\"height\":" << r.height
+                << ",\"channels\":" << r.channels;
+
+            if (!r.error.empty())
+            {
+                out << ",\"error\":\"";
+                AppendEscaped(out, r.error);
+                out << "\"}";
+                continue;
+            }
+
+            out << ",\"iterations\":" << r.iterations
+                << ",\"minNs\":" << r.minNs
+                << ",\"medianNs\":" << r.medianNs
+                << ",\"meanNs\":" << r.meanNs
+                << ",\"maxNs\":" << r.maxNs
+                << ",\"nsPerPixel\":" << r.nsPerPixel
+                << ",\"megapixelsPerSecond\":" << r.megapixelsPerSecond
+                << ",\"allocationsPerCall\":" << r.allocationsPerCall
+                << ",\"allocatedBytesPerCall\":" << r.allocatedBytesPerCall
+                << ",\"peakBytes\":" << r.peakBytes
+                << "}";
+        }
+
+        out << "\n]}\n";
+        return out.str();
+    }
+}
@@ -0,0 +1,93 @@
+/**********************************************************************************
+* CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+*                    This project lets you to quickly prototype a REST API
+*                    in a Node.js for a image processing service written in C++.
+*
+* Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+*
+* More information:
+*  - https://cloudcv.io
+*  - http://computer-vision-talks.com
+*
+**********************************************************************************/
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cloudcv
+{
+    /**
+     * @brief   What to benchmark and for how long.
+     * @details Every algorithm is run on synthetic images of each size and channel
+     *          count, and on each image file as it is decoded from disk.
+     */
+    struct BenchmarkOptions
+    {
+        BenchmarkOptions();
+
+        //! Names of algorithms to run; empty means every registered algorithm
+        std::vector<std::string> algorithms;
+
+        std::vector<cv::Size>    sizes;
+        std::vector<int>         channels;
+        std::vector<std::string> images;
+
+        //! Untimed runs before measurement, so pooled matrix buffers are warm
+        int    warmupIterations;
+
+        //! Each case runs at least minIterations times and at least minTimeMs
+        int    minIterations;
+        double minTimeMs;
+    };
+
+    /**
+     * @brief Measurements of one algorithm on one input.
+     */
+    struct BenchmarkResult
+    {
+        std::string algorithm;
+
+        //! "synthetic" or path of the image file
+        std::string input;
+        int         width;
+        int         height;
+        int         channels;
+
+        uint64_t    iterations;
+
+        //! Wall time of one call in nanoseconds
+        double      minNs;
+        double      medianNs;
+        double      meanNs;
+        double      maxNs;
+
+        //! Median time per input pixel and the resulting throughput
+        double      nsPerPixel;
+        double      megapixelsPerSecond;
+
+        //! Matrix allocations of one call, see MemoryAccount
+        double      allocationsPerCall;
+        double      allocatedBytesPerCall;
+        size_t      peakBytes;
+
+        //! Non-empty if the case could not be run
+        std::string error;
+    };
+
+    /**
+     * @brief   Benchmarks algorithm kernels without V8 and without the thread pool.
+     * @details Arguments are bound natively: image inputs get the benchmark image,
+     *          other inputs their default values. Only Algorithm::process is timed,
+     *          on the calling thread, so results reflect the kernel rather than
+     *          marshalling and queueing. Algorithms with required non-image 
+     *          arguments are reported with an error. Call from a background thread.
+     */
+    std::vector<BenchmarkResult> RunBenchmark(const BenchmarkOptions& options);
+
+    //! Serializes results together with OpenCV build information as JSON document
+    std::string BenchmarkReportJson(const std::vector<BenchmarkResult>& results);
+}
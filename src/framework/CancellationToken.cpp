@@ -0,0 +1,205 @@
+/**********************************************************************************
+* CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+*                    This project lets you to quickly prototype a REST API
+*                    in a Node.js for a image processing service written in C++.
+*
+* Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+*
+* More information:
+*  - https://cloudcv.io
+*  - http://computer-vision-talks.com
+*
+**********************************************************************************/
+#include "framework/CancellationToken.hpp"
+#include "framework/AlgorithmExceptions.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <stdexcept>
+
+namespace cloudcv
+{
+    //! Tokens of other callers; guarded, because callers join on the V8 thread while workers poll
+    struct CancellationToken::Callers
+    {
+        std::mutex                     lock;
+        std::vector<CancellationToken> tokens;
+    };
+
+    CancellationToken::CancellationToken()
+        : m_deadline(0)
+    {
+    }
+
+    CancellationToken::CancellationToken(const CancellationToken& other)
+        : m_deadline(0)
+    {
+        *this = other;
+    }
+
+    CancellationToken& CancellationToken::operator=(const CancellationToken& other)
+    {
+        if (this == &other)
+            return *this;
+
+        m_flag = other.m_flag;
+        m_deadline = other.m_deadline;
+        m_callers.reset();
+
+        // Copies get their own list of callers
+        if (other.m_callers)
+        {
+            std::lock_guard<std::mutex> guard(other.m_callers->lock);
+            m_callers = std::make_shared<Callers>();
+            m_callers->tokens = other.m_callers->tokens;
+        }
+
+        return *this;
+    }
+
+    void CancellationToken::attach(CancellationFlagPtr flag)
+    {
+        m_flag = flag;
+    }
+
+    void CancellationToken::setTimeout(double timeoutMs)
+    {
+        m_deadline = cv::getTickCount() + static_cast<int64_t>(timeoutMs * cv::getTickFrequency() / 1000.0);
+    }
+
+    bool CancellationToken::isCancellationRequested() const
+    {
+        return m_flag && m_flag->load(std::memory_order_relaxed);
+    }
+
+    bool CancellationToken::isDeadlineExceeded() const
+    {
+        return m_deadline != 0 && cv::getTickCount() >= m_deadline;
+    }
+
+    bool CancellationToken::empty() const
+    {
+        return !m_flag && m_deadline == 0;
+    }
+
+    void CancellationToken::allowCallers()
+    {
+        if (!m_callers)
+            m_callers = std::make_shared<Callers>();
+    }
+
+    void CancellationToken::addCaller(const CancellationToken& caller)
+    {
+        if (!m_callers)
+            throw std::logic_error("Callers can be added only to tokens prepared with allowCallers()");
+
+        std::lock_guard<std::mutex> guard(m_callers->lock);
+        m_callers->tokens.push_back(caller);
+    }
+
+    bool CancellationToken::isStopRequested() const
+    {
+        std::string message, code;
+        if (!cancellationError(message, code))
+            return false;
+
+        if (!m_callers)
+            return true;
+
+        std::lock_guard<std::mutex> guard(m_callers->lock);
+
+        for (const auto& caller : m_callers->tokens)
+        {
+            if (!caller.cancellationError(message, code))
+                return false;
+        }
+
+        return true;
+    }
+
+    void CancellationToken::throwIfCancelled() const
+    {
+        std::string message, code;
+
+        if (isStopRequested() && cancellationError(message, code))
+            throw OperationCancelledException(message, code);
+    }
+
+    bool CancellationToken::cancellationError(std::string& message, std::string& code) const
+    {
+        if (isCancellationRequested())
+        {
+            message = "Operation was cancelled";
+            code = "ECANCELED";
+            return true;
+        }
+
+        if (isDeadlineExceeded())
+        {
+            message = "Deadline exceeded";
+            code = "ETIMEDOUT";
+            return true;
+        }
+
+        return false;
+    }
+
+    CancellationTokenWrap::CancellationTokenWrap()
+        : m_flag(std::make_shared<std::atomic<bool>>(false))
+    {
+    }
+
+    CancellationFlagPtr CancellationTokenWrap::flag() const
+    {
+        return m_flag;
+    }
+
+    Nan::Persistent<v8::FunctionTemplate>& CancellationTokenWrap::constructorTemplate()
+    {
+        static Nan::Persistent<v8::FunctionTemplate> tpl;
+        return tpl;
+    }
+
+    NAN_MODULE_INIT(CancellationTokenWrap::Init)
+    {
+        v8::Local<v8::FunctionTemplate> tpl = Nan::New<v8::FunctionTemplate>(New);
+        tpl->SetClassName(Nan::New("CancellationToken").ToLocalChecked());
+        tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+        Nan::SetPrototypeMethod(tpl, "cancel", Cancel);
+        Nan::SetAccessor(tpl->InstanceTemplate(), Nan::New("cancelled").ToLocalChecked(), IsCancelled);
+
+        constructorTemplate().Reset(tpl);
+
+        Nan::Set(target, Nan::New("CancellationToken").ToLocalChecked(), Nan::GetFunction(tpl).ToLocalChecked());
+    }
+
+    bool CancellationTokenWrap::HasInstance(v8::Local<v8::Value> value)
+    {
+        return Nan::New(constructorTemplate())->HasInstance(value);
+    }
+
+    NAN_METHOD(CancellationTokenWrap::New)
+    {
+        if (!info.IsConstructCall())
+        {
+            Nan::ThrowTypeError("CancellationToken must be created with new");
+            return;
+        }
+
+        CancellationTokenWrap * token = new CancellationTokenWrap();
+        token->Wrap(info.This());
+        info.GetReturnValue().Set(info.This());
+    }
+
+    NAN_METHOD(CancellationTokenWrap::Cancel)
+    {
+        CancellationTokenWrap * token = Nan::ObjectWrap::Unwrap<CancellationTokenWrap>(info.Holder());
+        token->m_flag->store(true);
+    }
+
+    NAN_GETTER(CancellationTokenWrap::IsCancelled)
+    {
+        CancellationTokenWrap * token = Nan::ObjectWrap::Unwrap<CancellationTokenWrap>(info.Holder());
+        info.GetReturnValue().Set(Nan::New(token->m_flag->load()));
+    }
+}
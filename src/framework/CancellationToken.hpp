@@ -0,0 +1,121 @@
+/**********************************************************************************
+* CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+*                    This project lets you to quickly prototype a REST API
+*                    in a Node.js for a image processing service written in C++.
+*
+* Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+*
+* More information:
+*  - https://cloudcv.io
+*  - http://computer-vision-talks.com
+*
+**********************************************************************************/
+#pragma once
+
+#include <node.h>
+#include <v8.h>
+#include <nan.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace cloudcv
+{
+    typedef std::shared_ptr<std::atomic<bool>> CancellationFlagPtr;
+
+    /**
+     * @brief Cancellation state of a single job: optional abort flag shared with
+     *        JS CancellationToken object and optional deadline.
+     *
+     * The token is checked before job execution and can be polled by algorithms
+     * between processing stages. It is safe to read from worker threads.
+     */
+    class CancellationToken
+    {
+    public:
+        CancellationToken();
+
+        CancellationToken(const CancellationToken& other);
+
+        CancellationToken& operator=(const CancellationToken& other);
+
+        //! Shares abort flag with a JS CancellationToken object
+        void attach(CancellationFlagPtr flag);
+
+        //! Sets deadline relative to the current moment
+        void setTimeout(double timeoutMs);
+
+        //! True if the abort flag was raised
+        bool isCancellationRequested() const;
+
+        //! True if the deadline was set and has passed
+        bool isDeadlineExceeded() const;
+
+        //! True if neither abort flag nor deadline is set
+        bool empty() const;
+
+        /**
+         * @brief Prepares the token to accept other callers. Must be called before 
+         *        the job is queued, so worker threads never see the list appear.
+         */
+        void allowCallers();
+
+        /**
+         * @brief Adds token of another caller served by the same job. The job is then 
+         *        interrupted only when this token and every added one have fired, while 
+         *        each caller still gets its own error. May be called while the job is running.
+         */
+        void addCaller(const CancellationToken& caller);
+
+        //! True if the job should not continue: this token and all added callers fired
+        bool isStopRequested() const;
+
+        /**
+         * @brief Throws OperationCancelledException with ECANCELED or ETIMEDOUT code
+         *        if the job should not continue, see isStopRequested().
+         */
+        void throwIfCancelled() const;
+
+        /**
+         * @brief Returns true and the error the caller should get if abort flag 
+         *        was raised or deadline has passed. Added callers are not considered.
+         */
+        bool cancellationError(std::string& message, std::string& code) const;
+
+    private:
+        struct Callers;
+
+        CancellationFlagPtr      m_flag;
+        int64_t                  m_deadline;
+        std::shared_ptr<Callers> m_callers;
+    };
+
+    /**
+     * @brief JS-visible abort token: new cloudcv.CancellationToken(); token.cancel().
+     *        The same token can be passed to several calls.
+     */
+    class CancellationTokenWrap : public Nan::ObjectWrap
+    {
+    public:
+        static NAN_MODULE_INIT(Init);
+
+        static bool HasInstance(v8::Local<v8::Value> value);
+
+        CancellationFlagPtr flag() const;
+
+    private:
+        CancellationTokenWrap();
+
+        static NAN_METHOD(New);
+        static NAN_METHOD(Cancel);
+        static NAN_GETTER(IsCancelled);
+
+        static Nan::Persistent<v8::FunctionTemplate>& constructorTemplate();
+
+        CancellationFlagPtr m_flag;
+    };
+}
@@ -0,0 +1,92 @@
+/**********************************************************************************
+* CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+*                    This project lets you to quickly prototype a REST API
+*                    in a Node.js for a image processing service written in C++.
+*
+* Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+*
+* More information:
+*  - https://cloudcv.io
+*  - http://computer-vision-talks.com
+*
+**********************************************************************************/
+#include "framework/ContentHash.hpp"
+
+#include <cstring>
+
+namespace cloudcv
+{
+    namespace
+    {
+        const uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+        const uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+        const uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+
+        inline uint64_t Rotl(uint64_t x, int r)
+        {
+            return (x << r) | (x >> (64 - r));
+        }
+
+        inline uint64_t Read64(const uint8_t * p)
+        {
+            uint64_t v;
+            memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        inline uint64_t Round(uint64_t acc, uint64_t input)
+        {
+            acc += input * kPrime2;
+            acc  = Rotl(acc, 31);
+            return acc * kPrime1;
+        }
+
+        inline uint64_t Avalanche(uint64_t h)
+        {
+            h ^= h >> 33;
+            h *= kPrime2;
+            h ^= h >> 29;
+            h *= kPrime3;
+            h ^= h >> 32;
+            return h;
+        }
+    }
+
+    uint64_t ContentHash(const void * data, size_t length)
+    {
+        const uint8_t * p   = static_cast<const uint8_t*>(data);
+        const uint8_t * end = p + length;
+
+        // Four independent lanes keep the multiplier pipeline busy
+        uint64_t v1 = kPrime1 + kPrime2;
+        uint64_t v2 = kPrime2;
+        uint64_t v3 = 0;
+        uint64_t v4 = 0 - kPrime1;
+
+        while (end - p >= 32)
+        {
+            v1 = Round(v1, Read64(p));
+            v2 = Round(v2, Read64(p + 8));
+            v3 = Round(v3, Read64(p + 16));
+            v4 = Round(v4, Read64(p + 24));
+            p += 32;
+        }
+
+        uint64_t h = Rotl(v1, 1) + Rotl(v2, 7) + Rotl(v3, 12) + Rotl(v4, 18);
+        h ^= static_cast<uint64_t>(length) * kPrime3;
+
+        while (end - p >= 8)
+        {
+            h = Round(h, Read64(p));
+            p += 8;
+        }
+
+        while (p < end)
+        {
+            h = Round(h, *p);
+            p++;
+        }
+
+        return Avalanche(h);
+    }
+}
@@ -0,0 +1,32 @@
+/**********************************************************************************
+* CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+*                    This project lets you to quickly prototype a REST API
+*                    in a Node.js for a image processing service written in C++.
+*
+* Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+*
+* More information:
+*  - https://cloudcv.io
+*  - http://computer-vision-talks.com
+*
+**********************************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace cloudcv
+{
+    /**
+     * @brief   Computes fast non-cryptographic 64-bit hash of binary content.
+     * @details Used to identify identical encoded images. Not suitable for 
+     *          anything security-related.
+     */
+    uint64_t ContentHash(const void * data, size_t length);
+
+    //! Mixes value into accumulated hash
+    inline uint64_t HashCombine(uint64_t seed, uint64_t value)
+    {
+        return seed ^ (value + 0x9E3779B97F4A7C15ULL + (seed << 6) + (seed >> 2));
+    }
+}
@@ -0,0 +1,140 @@
+/**********************************************************************************
+* CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+*                    This project lets you to quickly prototype a REST API
+*                    in a Node.js for a image processing service written in C++.
+*
+* Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+*
+* More information:
+*  - https://cloudcv.io
+*  - http://computer-vision-talks.com
+*
+**********************************************************************************/
+#include "framework/ImageCache.hpp"
+#include "framework/Logger.hpp"
+
+#include <cstring>
+
+namespace cloudcv
+{
+    namespace
+    {
+        inline size_t ImageBytes(const cv::Mat& image)
+        {
+            return image.total() * image.elemSize();
+        }
+
+        inline bool SameEncoded(const std::vector<uchar>& stored, const uchar * encoded, size_t length)
+        {
+            return stored.size() == length && (length == 0 || std::memcmp(stored.data(), encoded, length) == 0);
+        }
+    }
+
+    ImageCache::ImageCache()
+        : m_budget(DefaultBudget)
+        , m_bytes(0)
+        , m_hits(0)
+        , m_misses(0)
+        , m_insertions(0)
+        , m_evictions(0)
+    {
+    }
+
+    ImageCache& ImageCache::Instance()
+    {
+        static ImageCache instance;
+        return instance;
+    }
+
+    bool ImageCache::lookup(const ImageCacheKey& key, const uchar * encoded, cv::Mat& image)
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+
+        // The key hash is not keyed, so equal keys of different images can be crafted
+        auto it = m_index.find(key);
+        if (it == m_index.end() || !SameEncoded(it->second->encoded, encoded, key.encodedLength))
+        {
+            m_misses++;
+            return false;
+        }
+
+        // Move entry to the head of LRU list
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        image = it->second->image;
+        m_hits++;
+        return true;
+    }
+
+    void ImageCache::insert(const ImageCacheKey& key, const uchar * encoded, const cv::Mat& image)
+    {
+        const size_t bytes = ImageBytes(image) + key.encodedLength;
+
+        std::lock_guard<std::mutex> guard(m_lock);
+
+        // On a key collision the entry that is already cached is kept
+        if (ImageBytes(image) == 0 || bytes > m_budget || m_index.count(key) > 0)
+            return;
+
+        evict(m_budget - bytes);
+
+        Entry entry;
+        entry.key     = key;
+        entry.encoded = std::vector<uchar>(encoded, encoded + key.encodedLength);
+        entry.image   = image;
+
+        m_entries.push_front(std::move(entry));
+        m_index.insert(std::make_pair(key, m_entries.begin()));
+        m_bytes += bytes;
+        m_insertions++;
+
+        LOG_TRACE_MESSAGE("ImageCache: inserted " << bytes << " bytes, total " << m_bytes);
+    }
+
+    void ImageCache::setBudget(size_t bytes)
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        m_budget = bytes;
+        evict(m_budget);
+    }
+
+    bool ImageCache::enabled() const
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        return m_budget > 0;
+    }
+
+    void ImageCache::clear()
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        m_index.clear();
+        m_entries.clear();
+        m_bytes = 0;
+    }
+
+    ImageCache::Statistics ImageCache::statistics() const
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+
+        Statistics stats;
+        stats.hits       = m_hits;
+        stats.misses     = m_misses;
+        stats.insertions = m_insertions;
+        stats.evictions  = m_evictions;
+        stats.entries    = m_index.size();
+        stats.bytes      = m_bytes;
+        stats.budget     = m_budget;
+        return stats;
+    }
+
+    void ImageCache::evict(size_t budget)
+    {
+        while (m_bytes > budget && !m_entries.empty())
+        {
+            const Entry& victim = m_entries.back();
+            m_bytes -= ImageBytes(victim.image) + victim.encoded.size();
+            m_index.erase(victim.key);
+            m_entries.pop_back();
+            m_evictions++;
+        }
+    }
+}
@@ -0,0 +1,149 @@
+/**********************************************************************************
+* CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+*                    This project lets you to quickly prototype a REST API
+*                    in a Node.js for a image processing service written in C++.
+*
+* Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+*
+* More information:
+*  - https://cloudcv.io
+*  - http://computer-vision-talks.com
+*
+**********************************************************************************/
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <nan.h>
+#include <nan-marshal.h>
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace cloudcv
+{
+    /**
+     * @brief Identifies decoded image by content of encoded data and decode parameters.
+     *        Equal keys are only a candidate match, the encoded bytes are compared too.
+     */
+    struct ImageCacheKey
+    {
+        uint64_t contentHash;
+        size_t   encodedLength;
+        int      colorMode;
+        int      maxResolution;
+
+        bool operator==(const ImageCacheKey& other) const
+        {
+            return contentHash == other.contentHash
+                && encodedLength == other.encodedLength
+                && colorMode == other.colorMode
+                && maxResolution == other.maxResolution;
+        }
+    };
+
+    /**
+     * @brief   Content-addressed LRU cache of decoded images.
+     * @details Repeated submissions of the same encoded image return already 
+     *          decoded matrix instead of decoding it again. Entries keep a copy of 
+     *          the encoded data and a hit is returned only if it is byte-equal, so 
+     *          a crafted hash collision cannot read an image decoded for another 
+     *          client. Cached matrices are shared with consumers and must not be 
+     *          modified (ImageView does copy-on-write for that). The cache is 
+     *          thread-safe.
+     */
+    class ImageCache
+    {
+    public:
+        struct Statistics
+        {
+            uint64_t hits;
+            uint64_t misses;
+            uint64_t insertions;
+            uint64_t evictions;
+            size_t   entries;
+            size_t   bytes;
+            size_t   budget;
+        };
+
+        //! Default budget of the cache in bytes
+        static const size_t DefaultBudget = 64 * 1024 * 1024;
+
+        static ImageCache& Instance();
+
+        bool lookup(const ImageCacheKey& key, const uchar * encoded, cv::Mat& image);
+
+        void insert(const ImageCacheKey& key, const uchar * encoded, const cv::Mat& image);
+
+        //! Sets memory budget of the cache in bytes. Zero budget disables the cache.
+        void setBudget(size_t bytes);
+
+        bool enabled() const;
+
+        void clear();
+
+        Statistics statistics() const;
+
+    private:
+        ImageCache();
+
+        struct KeyHash
+        {
+            size_t operator()(const ImageCacheKey& key) const
+            {
+                return static_cast<size_t>(key.contentHash ^ (uint64_t(key.colorMode) << 32) ^ uint64_t(key.maxResolution));
+            }
+        };
+
+        struct Entry
+        {
+            ImageCacheKey      key;
+            std::vector<uchar> encoded;
+            cv::Mat            image;
+        };
+
+        typedef std::list<Entry>                   EntryList;
+
+        void evict(size_t budget);
+
+        mutable std::mutex m_lock;
+        EntryList          m_entries;
+        std::unordered_map<ImageCacheKey, EntryList::iterator, KeyHash> m_index;
+
+        size_t             m_budget;
+        size_t             m_bytes;
+        uint64_t           m_hits;
+        uint64_t           m_misses;
+        uint64_t           m_insertions;
+        uint64_t           m_evictions;
+    };
+}
+
+namespace Nan
+{
+    namespace marshal
+    {
+        using namespace cloudcv;
+
+        template<>
+        struct Serializer<ImageCache::Statistics>
+        {
+            template<typename InputArchive>
+            static inline void load(InputArchive& ar, ImageCache::Statistics& val) = delete;
+
+            template<typename OutputArchive>
+            static inline void save(OutputArchive& ar, const ImageCache::Statistics& val)
+            {
+                ar & make_nvp("hits",       static_cast<double>(val.hits));
+                ar & make_nvp("misses",     static_cast<double>(val.misses));
+                ar & make_nvp("insertions", static_cast<double>(val.insertions));
+                ar & make_nvp("evictions",  static_cast<double>(val.evictions));
+                ar & make_nvp("entries",    static_cast<double>(val.entries));
+                ar & make_nvp("bytes",      static_cast<double>(val.bytes));
+                ar & make_nvp("budget",     static_cast<double>(val.budget));
+            }
+        };
+    }
+}
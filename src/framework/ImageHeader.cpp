@@ -0,0 +1,111 @@
+/**********************************************************************************
+* CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+*                    This project lets you to quickly prototype a REST API
+*                    in a Node.js for a image processing service written in C++.
+*
+* Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+*
+* More information:
+*  - https://cloudcv.io
+*  - http://computer-vision-talks.com
+*
+**********************************************************************************/
+#include "framework/ImageHeader.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace cloudcv
+{
+    namespace
+    {
+        inline uint32_t ReadBE16(const uint8_t * p) { return (uint32_t(p[0]) << 8) | p[1]; }
+        inline uint32_t ReadBE32(const uint8_t * p) { return (ReadBE16(p) << 16) | ReadBE16(p + 2); }
+        inline uint32_t ReadLE16(const uint8_t * p) { return (uint32_t(p[1]) << 8) | p[0]; }
+        inline uint32_t ReadLE32(const uint8_t * p) { return (ReadLE16(p + 2) << 16) | ReadLE16(p); }
+
+        bool ParsePngHeader(const uint8_t * data, size_t length, ImageHeader& header)
+        {
+            static const uint8_t signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+            if (length < 26 || memcmp(data, signature, sizeof(signature)) != 0 || memcmp(data + 12, "IHDR", 4) != 0)
+                return false;
+
+            header.width  = (int)ReadBE32(data + 16);
+            header.height = (int)ReadBE32(data + 20);
+            header.depth  = data[24] == 16 ? 2 : 1;
+
+            switch (data[25])
+            {
+            case 0:  header.channels = 1; break; // Grayscale
+            case 4:  header.channels = 2; break; // Grayscale + alpha
+            case 6:  header.channels = 4; break; // RGBA
+            default: header.channels = 3; break; // RGB or palette
+            }
+
+            return true;
+        }
+
+        bool ParseJpegHeader(const uint8_t * data, size_t length, ImageHeader& header)
+        {
+            if (length < 4 || data[0] != 0xFF || data[1] != 0xD8)
+                return false;
+
+            size_t offset = 2;
+            while (offset + 4 <= length)
+            {
+                if (data[offset] != 0xFF)
+                    return false;
+
+                uint8_t marker = data[offset + 1];
+                if (marker == 0xFF)
+                {
+                    offset++; // Fill byte
+                    continue;
+                }
+
+                size_t segmentLength = ReadBE16(data + offset + 2);
+
+                // Start of frame markers, excluding DHT, JPG and DAC
+                bool isFrame = marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+                if (isFrame)
+                {
+                    if (offset + 10 > length)
+                        return false;
+
+                    header.height   = (int)ReadBE16(data + offset + 5);
+                    header.width    = (int)ReadBE16(data + offset + 7);
+                    header.channels = data[offset + 9];
+                    header.depth    = data[offset + 4] > 8 ? 2 : 1;
+                    return true;
+                }
+
+                offset += 2 + segmentLength;
+            }
+
+            return false;
+        }
+
+        bool ParseBmpHeader(const uint8_t * data, size_t length, ImageHeader& header)
+        {
+            if (length < 30 || data[0] != 'B' || data[1] != 'M')
+                return false;
+
+            header.width    = std::abs((int32_t)ReadLE32(data + 18));
+            header.height   = std::abs((int32_t)ReadLE32(data + 22));
+            header.channels = ReadLE16(data + 28) == 32 ? 4 : 3;
+            header.depth    = 1;
+            return true;
+        }
+    }
+
+    bool ParseImageHeader(const uint8_t * data, size_t length, ImageHeader& header)
+    {
+        if (data == nullptr)
+            return false;
+
+        return ParsePngHeader(data, length, header)
+            || ParseJpegHeader(data, length, header)
+            || ParseBmpHeader(data, length, header);
+    }
+}
@@ -0,0 +1,38 @@
+/**********************************************************************************
+* CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+*                    This project lets you to quickly prototype a REST API
+*                    in a Node.js for a image processing service written in C++.
+*
+* Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+*
+* More information:
+*  - https://cloudcv.io
+*  - http://computer-vision-talks.com
+*
+**********************************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace cloudcv
+{
+    /**
+     * @brief Basic properties of encoded image that can be read without decoding it.
+     */
+    struct ImageHeader
+    {
+        int width;
+        int height;
+        int channels;
+
+        //! Bytes per channel sample of the full-depth image
+        int depth;
+    };
+
+    /**
+     * @brief   Reads image dimensions from the header of encoded PNG, JPEG or BMP image.
+     * @return  True if the format was recognized and header was parsed successfully.
+     */
+    bool ParseImageHeader(const uint8_t * data, size_t length, ImageHeader& header);
+}
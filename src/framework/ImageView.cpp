@@ -15,40 +15,518 @@
 #include <nan.h>
 
 #include "framework/Logger.hpp"
+#include "framework/ImageHeader.hpp"
+#include "framework/ImageCache.hpp"
+#include "framework/ContentHash.hpp"
+#include "framework/RequestTimings.hpp"
 #include "ImageView.hpp"
 #include "Algorithm.hpp"
 #include "framework/marshal/marshal.hpp"
 
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <tuple>
+
+#define CLOUDCV_HAVE_REDUCED_DECODE (CV_VERSION_MAJOR > 3 || (CV_VERSION_MAJOR == 3 && CV_VERSION_MINOR >= 2))
 
 
 
 namespace cloudcv
 {
+    DecodeHints::DecodeHints(int colorMode, int maxResolution)
+        : colorMode(colorMode)
+        , maxResolution(maxResolution)
+    {
+    }
+
+    DecodeHints DecodeHints::merge(const DecodeHints& other) const
+    {
+        DecodeHints result;
+
+        if (colorMode == other.colorMode)
+            result.colorMode = colorMode;
+        else if (colorMode == cv::IMREAD_UNCHANGED || other.colorMode == cv::IMREAD_UNCHANGED)
+            result.colorMode = cv::IMREAD_UNCHANGED;
+        else
+            result.colorMode = cv::IMREAD_COLOR;
+
+        if (maxResolution == 0 || other.maxResolution == 0)
+            result.maxResolution = 0;
+        else
+            result.maxResolution = std::max(maxResolution, other.maxResolution);
+
+        return result;
+    }
+
+    namespace
+    {
+        int ReductionFactor(const uchar * data, size_t length, const DecodeHints& hints)
+        {
+            ImageHeader header;
+            if (hints.maxResolution <= 0 || !ParseImageHeader(data, length, header))
+                return 1;
+
+            const int longestSide = std::max(header.width, header.height);
+
+            int factor = 1;
+            while (factor < 8 && longestSide / (factor * 2) >= hints.maxResolution)
+                factor *= 2;
+
+            return factor;
+        }
+
+        //! True if the decoder downscales by itself, otherwise full-size image is decoded and resized
+        bool ReducedDecoding(int factor, const DecodeHints& hints)
+        {
+#if CLOUDCV_HAVE_REDUCED_DECODE
+            // Reduced flags always decode to 8-bit colour or grayscale, which would 
+            // drop alpha and 16-bit depth of IMREAD_UNCHANGED
+            return factor > 1 && hints.colorMode != cv::IMREAD_UNCHANGED;
+#else
+            (void)factor;
+            (void)hints;
+            return false;
+#endif
+        }
+
+        //! Peak memory of decoding: decoded image and the full-size one it is resized from, if any
+        size_t DecodedSizeEstimate(const uchar * data, size_t length, const DecodeHints& hints)
+        {
+            ImageHeader header;
+            if (!ParseImageHeader(data, length, header))
+                return length;
+
+            size_t pixelBytes;
+
+            switch (hints.colorMode)
+            {
+            case cv::IMREAD_GRAYSCALE:
+                pixelBytes = 1;
+                break;
+
+            case cv::IMREAD_UNCHANGED:
+                // Grayscale with alpha is decoded to four channels
+                pixelBytes = (header.channels == 2 ? 4 : header.channels) * header.depth;
+                break;
+
+            default:
+                pixelBytes = 3;
+                break;
+            }
+
+            const int    factor   = ReductionFactor(data, length, hints);
+            const size_t fullSize = size_t(header.width) * header.height * pixelBytes;
+            const size_t decoded  = size_t(header.width / factor) * (header.height / factor) * pixelBytes;
+
+            if (factor > 1 && !ReducedDecoding(factor, hints))
+                return fullSize + decoded;
+
+            return decoded;
+        }
+
+        cv::Mat DecodeEncodedImage(const uchar * data, size_t length, const DecodeHints& hints)
+        {
+            cv::Mat encoded(1, (int)length, CV_8UC1, const_cast<uchar*>(data));
+            const int factor = ReductionFactor(data, length, hints);
+
+            cv::Mat m;
+
+#if CLOUDCV_HAVE_REDUCED_DECODE
+            if (ReducedDecoding(factor, hints))
+            {
+                const bool grayscale = hints.colorMode == cv::IMREAD_GRAYSCALE;
+                int flags = hints.colorMode;
+
+                switch (factor)
+                {
+                case 2: flags = grayscale ? cv::IMREAD_REDUCED_GRAYSCALE_2 : cv::IMREAD_REDUCED_COLOR_2; break;
+                case 4: flags = grayscale ? cv::IMREAD_REDUCED_GRAYSCALE_4 : cv::IMREAD_REDUCED_COLOR_4; break;
+                case 8: flags = grayscale ? cv::IMREAD_REDUCED_GRAYSCALE_8 : cv::IMREAD_REDUCED_COLOR_8; break;
+                default: break;
+                }
+
+                m = cv::imdecode(encoded, flags);
+            }
+            else
+#endif
+            {
+                // Reduced decoding is not available or not applicable, downscale after decoding instead
+                m = cv::imdecode(encoded, hints.colorMode);
+                if (factor > 1 && !m.empty())
+                    cv::resize(m, m, cv::Size(), 1.0 / factor, 1.0 / factor, cv::INTER_AREA);
+            }
+
+            if (m.empty())
+                throw std::runtime_error("Cannot decode image");
+
+            return m;
+        }
+
+        //! contentHash may be null if hash of the data is not known yet
+        cv::Mat DecodeImage(const uchar * data, size_t length, const DecodeHints& hints, const uint64_t * contentHash)
+        {
+            ImageCache& cache = ImageCache::Instance();
+            if (!cache.enabled())
+                return DecodeEncodedImage(data, length, hints);
+
+            ImageCacheKey key;
+            key.contentHash   = contentHash ? *contentHash : ContentHash(data, length);
+            key.encodedLength = length;
+            key.colorMode     = hints.colorMode;
+            key.maxResolution = hints.maxResolution;
+
+            cv::Mat image;
+            if (cache.lookup(key, data, image))
+            {
+                LOG_TRACE_MESSAGE("ImageCache hit");
+                return image;
+            }
+
+            image = DecodeEncodedImage(data, length, hints);
+            cache.insert(key, data, image);
+            return image;
+        }
+
+        cv::Mat ConvertColor(const cv::Mat& src, int flags)
+        {
+            cv::Mat result;
+
+            switch (flags)
+            {
+            case cv::IMREAD_GRAYSCALE:
+                if (src.channels() == 3 || src.channels() == 4)
+                    cv::cvtColor(src, result, src.channels() == 4 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+                else if (src.channels() == 1)
+                    result = src;
+                else
+                    throw std::runtime_error("Cannot convert image to grayscale");
+                break;
+
+            case cv::IMREAD_COLOR:
+                if (src.channels() == 3 || src.channels() == 4)
+                    result = src;
+                else if (src.channels() == 1)
+                    cv::cvtColor(src, result, cv::COLOR_GRAY2BGR);
+                else
+                    throw std::runtime_error("Cannot convert image to RGB");
+                break;
+
+            case cv::IMREAD_UNCHANGED:
+            default:
+                result = src;
+                break;
+            }
+
+            return result;
+        }
+    }
+
     class ImageView::ImageSourceImpl
     {
     public:
         ImageSourceImpl()
+            : m_decoded(true)
         {
         }
 
         ImageSourceImpl(cv::Mat image)
+            : m_holder(image)
+            , m_decoded(true)
         {
-            image.copyTo(m_holder);
         }
 
         virtual ~ImageSourceImpl() = default;
 
         inline const cv::Mat& getImage() const
         {
+            ensureDecoded();
             return m_holder;
         }
         
         inline cv::Mat& getImage()
         {
+            ensureDecoded();
             return m_holder;
         }
+
+        /**
+         * @brief   Returns derived representation of the image (colour space, depth and pyramid level).
+         * @details Each variant is computed once and shared by all consumers of this image.
+         */
+        cv::Mat getVariant(int flags, int depth, int level) const
+        {
+            const cv::Mat& source = getImage();
+
+            if (level == 0 && (depth < 0 || depth == source.depth()))
+            {
+                if (flags == cv::IMREAD_UNCHANGED)
+                    return source;
+
+                if (flags == cv::IMREAD_GRAYSCALE && source.channels() == 1)
+                    return source;
+            }
+
+            std::lock_guard<std::recursive_mutex> guard(m_variantsLock);
+
+            const VariantKey key(flags, depth, level);
+            auto it = m_variants.find(key);
+            if (it != m_variants.end())
+                return it->second;
+
+            ScopedStage stage(RequestTimings::Convert);
+            cv::Mat variant;
+
+            if (level > 0)
+            {
+                cv::pyrDown(getVariant(flags, depth, level - 1), variant);
+            }
+            else if (depth >= 0 && depth != source.depth())
+            {
+                getVariant(flags, -1, 0).convertTo(variant, depth);
+            }
+            else
+            {
+                variant = ConvertColor(source, flags);
+            }
+
+            m_variants.insert(std::make_pair(key, variant));
+            return variant;
+        }
+
+        //! Drops derived representations when image is about to be modified
+        inline void clearVariants()
+        {
+            std::lock_guard<std::recursive_mutex> guard(m_variantsLock);
+            m_variants.clear();
+        }
+
+        virtual size_t memoryEstimate() const
+        {
+            if (!m_decoded.load(std::memory_order_acquire))
+                return 0;
+
+            return m_holder.total() * m_holder.elemSize();
+        }
+
+        /**
+         * @brief Key of the decoded image: content of the source and decode hints.
+         *        Returns false for sources that cannot be identified cheaply.
+         */
+        virtual bool contentKey(uint64_t& /*key*/) const
+        {
+            return false;
+        }
+
+        virtual bool sameContent(const ImageSourceImpl& /*other*/) const
+        {
+            return false;
+        }
+
+        virtual bool encodedData(const char *& /*data*/, size_t& /*length*/, uint64_t& /*contentHash*/) const
+        {
+            return false;
+        }
+
+        virtual bool sourcePath(std::string& /*path*/) const
+        {
+            return false;
+        }
+
+        inline void setDecodeHints(const DecodeHints& hints)
+        {
+            m_hints = m_hasHints ? m_hints.merge(hints) : hints;
+            m_hasHints = true;
+        }
+
+    protected:
+        //! Constructor for deferred sources that decode image on first access
+        struct DeferredTag {};
+
+        ImageSourceImpl(DeferredTag)
+            : m_decoded(false)
+        {
+        }
+
+        inline const DecodeHints& decodeHints() const
+        {
+            return m_hints;
+        }
+
+        /**
+         * @brief Decodes the image. Called at most once, from the thread that
+         *        first accesses the image (normally a worker thread).
+         */
+        virtual cv::Mat decode() const
+        {
+            return cv::Mat();
+        }
+
     private:
-        cv::Mat m_holder;
+        inline void ensureDecoded() const
+        {
+            if (m_decoded.load(std::memory_order_acquire))
+                return;
+
+            std::lock_guard<std::mutex> guard(m_decodeLock);
+            if (!m_decoded.load(std::memory_order_relaxed))
+            {
+                ScopedStage stage(RequestTimings::Decode);
+                m_holder = decode();
+                m_decoded.store(true, std::memory_order_release);
+            }
+        }
+
+        typedef std::tuple<int, int, int> VariantKey;
+
+        mutable std::map<VariantKey, cv::Mat> m_variants;
+        mutable std::recursive_mutex          m_variantsLock;
+
+        mutable cv::Mat           m_holder;
+        mutable std::mutex        m_decodeLock;
+        mutable std::atomic<bool> m_decoded;
+        DecodeHints               m_hints;
+        bool                      m_hasHints = false;
+    };
+
+    /**
+     * @brief Decodes image directly from the memory of a Node.js Buffer.
+     * @details The buffer is pinned with a persistent handle for the lifetime of 
+     *          this object, so no copy of encoded data is made. Instances are 
+     *          owned by argument bindings of a job and must be released in the 
+     *          V8 thread, which happens when the job is destroyed after completion.
+     */
+    class BufferImageSource : public ImageView::ImageSourceImpl
+    {
+    public:
+        BufferImageSource(v8::Local<v8::Object> imageBuffer)
+            : ImageSourceImpl(DeferredTag())
+            , m_buffer(imageBuffer)
+            , m_data(node::Buffer::Data(imageBuffer))
+            , m_length(node::Buffer::Length(imageBuffer))
+            , m_contentHash(0)
+            , m_hasContentHash(false)
+        {
+        }
+
+        ~BufferImageSource()
+        {
+            m_buffer.Reset();
+        }
+
+        size_t memoryEstimate() const override
+        {
+            const size_t decoded = ImageSourceImpl::memoryEstimate();
+            if (decoded > 0)
+                return m_length + decoded;
+
+            return m_length + DecodedSizeEstimate(reinterpret_cast<const uchar*>(m_data), m_length, decodeHints());
+        }
+
+        //! Called from the V8 thread before the job is queued; the hash is reused by the image cache
+        bool contentKey(uint64_t& key) const override
+        {
+            key = HashCombine(HashCombine(contentHash(), m_length), HashCombine(decodeHints().colorMode, decodeHints().maxResolution));
+            return true;
+        }
+
+        bool sameContent(const ImageSourceImpl& other) const override
+        {
+            const BufferImageSource * source = dynamic_cast<const BufferImageSource*>(&other);
+            if (source == nullptr || source->m_length != m_length)
+                return false;
+
+            if (source->decodeHints().colorMode != decodeHints().colorMode || source->decodeHints().maxResolution != decodeHints().maxResolution)
+                return false;
+
+            return source->m_data == m_data || memcmp(source->m_data, m_data, m_length) == 0;
+        }
+
+        bool encodedData(const char *& data, size_t& length, uint64_t& hash) const override
+        {
+            data = m_data;
+            length = m_length;
+            hash = contentHash();
+            return true;
+        }
+
+    protected:
+        cv::Mat decode() const override
+        {
+            TRACE_FUNCTION;
+            return DecodeImage(reinterpret_cast<const uchar*>(m_data), m_length, decodeHints(), m_hasContentHash ? &m_contentHash : nullptr);
+        }
+
+    private:
+        //! Hash of the encoded data, computed on first use. V8 thread only.
+        uint64_t contentHash() const
+        {
+            if (!m_hasContentHash)
+            {
+                m_contentHash = ContentHash(m_data, m_length);
+                m_hasContentHash = true;
+            }
+
+            return m_contentHash;
+        }
+
+        Nan::Persistent<v8::Object> m_buffer;
+        const char *                m_data;
+        size_t                      m_length;
+        mutable uint64_t            m_contentHash;
+        mutable bool                m_hasContentHash;
+    };
+
+    /**
+     * @brief Keeps a path to the image file and reads it on first access.
+     *        File content is decoded from memory to honor decode hints.
+     *        The source has no content key: the file may change between 
+     *        requests, so a path does not identify the image. The image 
+     *        cache is keyed by the bytes that were actually read.
+     */
+    class FileImageSource : public ImageView::ImageSourceImpl
+    {
+    public:
+        FileImageSource(const std::string& filepath)
+            : ImageSourceImpl(DeferredTag())
+            , m_filepath(filepath)
+        {
+        }
+
+    protected:
+        cv::Mat decode() const override
+        {
+            TRACE_FUNCTION;
+            std::ifstream file(m_filepath.c_str(), std::ios::binary | std::ios::ate);
+            if (!file)
+                throw std::runtime_error("Cannot read image file " + m_filepath);
+
+            // Devices and pipes report no size and are refused rather than read without bound
+            const std::streamoff size = file.tellg();
+            if (size <= 0 || size > std::numeric_limits<int>::max())
+                throw std::runtime_error("Cannot read image file " + m_filepath);
+
+            // Buffer comes from the matrix allocator, so the job memory limit applies before reading
+            cv::Mat encoded(1, static_cast<int>(size), CV_8UC1);
+
+            file.seekg(0);
+            if (!file.read(reinterpret_cast<char*>(encoded.data), size))
+                throw std::runtime_error("Cannot read image file " + m_filepath);
+
+            return DecodeImage(encoded.data, encoded.total(), decodeHints(), nullptr);
+        }
+
+        bool sourcePath(std::string& path) const override
+        {
+            path = m_filepath;
+            return true;
+        }
+
+    private:
+        std::string m_filepath;
     };
     
     ImageView::ImageView()
@@ -76,47 +554,56 @@ namespace cloudcv
     {
         if (m_impl.get() != nullptr)
         {
+            detach();
+            m_impl->clearVariants();
             return m_impl->getImage();
         }
 
         throw std::runtime_error("Image is empty");
     }
 
-    cv::Mat ImageView::getImage(int flags /* = cv::IMREAD_COLOR */) const
+    void ImageView::detach()
     {
-        const cv::Mat& src = getImage();
+        const cv::Mat& image = m_impl->getImage();
 
-        cv::Mat result;
+        bool sharedView  = m_impl.use_count() > 1;
+        bool sharedData  = image.u != nullptr && image.u->refcount > 1;
+        bool foreignData = image.u == nullptr && image.data != nullptr;
 
-        switch (flags)
+        if (sharedView || sharedData || foreignData)
         {
-        case cv::IMREAD_GRAYSCALE:
-            if (src.channels() == 3 || src.channels() == 4)
-                cv::cvtColor(src, result, cv::COLOR_RGB2GRAY);
-            else if (src.channels() == 1)
-                result = src;
-            else
-                throw std::runtime_error("Cannot convert image to grayscale");
-            break;
+            LOG_TRACE_MESSAGE("ImageView: copy on write");
+            m_impl = std::shared_ptr<ImageSourceImpl>(new ImageSourceImpl(image.clone()));
+        }
+    }
 
-        case cv::IMREAD_COLOR:
-            if (src.channels() == 3 || src.channels() == 4)
-                result = src;
-            else if (src.channels() == 1)
-                cv::cvtColor(src, result, cv::COLOR_GRAY2RGB);
-            else
-                throw std::runtime_error("Cannot convert image to RGB");
-            break;
+    cv::Mat ImageView::getImage(int flags /* = cv::IMREAD_COLOR */) const
+    {
+        return getImage(flags, -1);
+    }
 
-        case cv::IMREAD_UNCHANGED:
-        default:
-            result = src;
-            break;
+    cv::Mat ImageView::getImage(int flags, int depth) const
+    {
+        if (m_impl.get() != nullptr)
+        {
+            return m_impl->getVariant(flags, depth, 0);
         }
 
-        return result;
+        throw std::runtime_error("Image is empty");
     }
 
+    cv::Mat ImageView::getPyramidLevel(int level, int flags) const
+    {
+        if (level < 0)
+            throw std::runtime_error("Pyramid level cannot be negative");
+
+        if (m_impl.get() != nullptr)
+        {
+            return m_impl->getVariant(flags, -1, level);
+        }
+
+        throw std::runtime_error("Image is empty");
+    }
 
     ImageView ImageView::CreateImageSource(v8::Local<v8::Value> bufferOrString)
     {
@@ -134,18 +621,51 @@ namespace cloudcv
     ImageView ImageView::CreateImageSource(v8::Local<v8::Object> imageBuffer)
     {
         LOG_TRACE_MESSAGE("ImageSource [Buffer]");        
-        auto mImageData = node::Buffer::Data(imageBuffer);
-        auto mImageDataLen = node::Buffer::Length(imageBuffer);
-
-        cv::Mat m = cv::imdecode(cv::_InputArray(mImageData, (int)mImageDataLen), cv::IMREAD_UNCHANGED);
-        return ImageView(std::shared_ptr<ImageSourceImpl>(new ImageSourceImpl(m)));
+        return ImageView(std::shared_ptr<ImageSourceImpl>(new BufferImageSource(imageBuffer)));
     }
 
     ImageView ImageView::CreateImageSource(const std::string& filepath)
     {
         LOG_TRACE_MESSAGE("ImageSource [File]:" << filepath);
-        cv::Mat m = cv::imread(filepath, cv::IMREAD_UNCHANGED);
-        return ImageView(std::shared_ptr<ImageSourceImpl>(new ImageSourceImpl(m)));
+        return ImageView(std::shared_ptr<ImageSourceImpl>(new FileImageSource(filepath)));
+    }
+
+    ImageView ImageView::ViewForImage(const cv::Mat& image)
+    {
+        return ImageView(std::shared_ptr<ImageSourceImpl>(new ImageSourceImpl(image)));
+    }
+
+    size_t ImageView::memoryEstimate() const
+    {
+        return m_impl.get() != nullptr ? m_impl->memoryEstimate() : 0;
+    }
+
+    bool ImageView::contentKey(uint64_t& key) const
+    {
+        return m_impl.get() != nullptr && m_impl->contentKey(key);
+    }
+
+    bool ImageView::sameContent(const ImageView& other) const
+    {
+        return m_impl.get() != nullptr && other.m_impl.get() != nullptr && m_impl->sameContent(*other.m_impl);
+    }
+
+    bool ImageView::encodedData(const char *& data, size_t& length, uint64_t& contentHash) const
+    {
+        return m_impl.get() != nullptr && m_impl->encodedData(data, length, contentHash);
+    }
+
+    bool ImageView::sourcePath(std::string& path) const
+    {
+        return m_impl.get() != nullptr && m_impl->sourcePath(path);
+    }
+
+    void ImageView::setDecodeHints(const DecodeHints& hints)
+    {
+        if (m_impl.get() != nullptr)
+        {
+            m_impl->setDecodeHints(hints);
+        }
     }
 
 }
\ No newline at end of file
@@ -14,6 +14,7 @@
 
 #include <opencv2/opencv.hpp>
 #include <memory>
+#include <cstdint>
 #include <node.h>
 #include <v8.h>
 #include <nan.h>
@@ -21,29 +22,82 @@
 
 namespace cloudcv
 {
+    /**
+     * @brief   Describes which representation of the image an algorithm needs.
+     * @details Hints let the decoder produce exactly what the algorithm needs 
+     *          (e.g. decode JPEG directly to grayscale at reduced resolution) 
+     *          instead of decoding full colour frame and converting it afterwards.
+     */
+    struct DecodeHints
+    {
+        DecodeHints(int colorMode = cv::IMREAD_UNCHANGED, int maxResolution = 0);
+
+        //! One of cv::IMREAD_UNCHANGED, cv::IMREAD_COLOR or cv::IMREAD_GRAYSCALE
+        int colorMode;
+
+        //! Longest image side the algorithm needs. The decoder may downscale image 
+        //! by a factor of 2, 4 or 8 as long as result is not smaller than this value.
+        //! Zero means full resolution.
+        int maxResolution;
+
+        //! Returns hints that satisfy requirements of both this and other hints
+        DecodeHints merge(const DecodeHints& other) const;
+    };
+
     /**
      * @brief   Image source is accessor to image, stored in external resource.
      * @details This abstract class has particular implementations to retrieve 
-     *          image data from file system and image buffer.
+     *          image data from file system and image buffer. Sources created from
+     *          a file path or an encoded buffer are decoded lazily on first access
+     *          to the image, so binding arguments on the V8 thread stays cheap and
+     *          decoding happens in the worker thread that runs the algorithm.
      */
     class ImageView
     {
     public:
         /**
          * @brief   Main method to retrieve image. This method will work synchronously.
-         * @details Returns the image stored in the ImageSource object.
+         * @details Returns the image stored in the ImageSource object, converted to 
+         *          requested colour mode. Conversion result is cached and must not 
+         *          be modified.
          * @return  This function returns the loaded image. It can also return an 
          *          empty object if the image could not been loaded.
          */
         cv::Mat getImage(int flags) const;
+
+        /**
+         * @brief   Returns the image in requested colour mode converted to given depth.
+         * @details Converted representations are computed once and cached inside the 
+         *          image source, so all consumers of the same image share them. 
+         *          Returned matrix shares data with the cache and must not be modified.
+         * @param   flags Colour mode (cv::IMREAD_UNCHANGED, cv::IMREAD_COLOR or cv::IMREAD_GRAYSCALE)
+         * @param   depth Target depth (CV_8U, CV_32F, ...) or -1 to keep source depth.
+         *                Values are converted without scaling.
+         */
+        cv::Mat getImage(int flags, int depth) const;
+
+        /**
+         * @brief   Returns level of the Gaussian pyramid built with cv::pyrDown.
+         * @details Level 0 is the image itself. Pyramid levels are cached the same
+         *          way as colour conversions and must not be modified.
+         */
+        cv::Mat getPyramidLevel(int level, int flags = cv::IMREAD_GRAYSCALE) const;
         
         const cv::Mat& getImage() const;
+
+        /**
+         * @brief   Returns image for modification.
+         * @details Image data is shared between views and Mat headers without copying.
+         *          Mutable access makes a private deep copy first if the data is shared
+         *          with anyone else (copy-on-write).
+         */
         cv::Mat& getImage();
 
         virtual ~ImageView() {}
 
         /**
         * @brief Creates an ImageSource that points to particular file on filesystem.
+        *        The file is read on first access to the image.
         */
         static ImageView CreateImageSource(const std::string& filepath);
 
@@ -55,10 +109,53 @@ namespace cloudcv
 
         /**
         * @brief Creates an ImageSource that points to file's binary content that was
-        *        loaded using Node.js.
+        *        loaded using Node.js. The buffer is referenced without copying and 
+        *        decoded on first access to the image.
         */
         static ImageView CreateImageSource(v8::Local<v8::Object> imageBuffer);
 
+        /**
+        * @brief Creates an ImageSource that shares data with given image without copying.
+        */
+        static ImageView ViewForImage(const cv::Mat& image);
+
+        /**
+        * @brief Sets decode hints for image sources that are not decoded yet.
+        *        If hints were already set, they are merged so the decoded image 
+        *        satisfies all consumers. Has no effect on already decoded images.
+        */
+        void setDecodeHints(const DecodeHints& hints);
+
+        /**
+        * @brief Estimates memory held by the image in bytes. For images that are 
+        *        not decoded yet the size of decoded image is predicted from the 
+        *        image header, decode hints and size of the encoded data.
+        */
+        size_t memoryEstimate() const;
+
+        /**
+        * @brief Computes key that identifies encoded source and decode hints of the image,
+        *        so identical requests can be recognized before decoding. Returns false 
+        *        for images that were created from matrices.
+        */
+        bool contentKey(uint64_t& key) const;
+
+        /**
+        * @brief Compares encoded source and decode hints with other image byte by byte,
+        *        to confirm a contentKey match. Returns false if either image has no 
+        *        encoded source. V8 thread only.
+        */
+        bool sameContent(const ImageView& other) const;
+
+        /**
+        * @brief Returns encoded data of images created from a buffer, together with 
+        *        its content hash. Data is owned by the JS buffer. V8 thread only.
+        */
+        bool encodedData(const char *& data, size_t& length, uint64_t& contentHash) const;
+
+        //! Returns path of images created from a file path
+        bool sourcePath(std::string& path) const;
+
         class ImageSourceImpl;
 
         ImageView();
@@ -68,6 +165,8 @@ namespace cloudcv
 
 
     private:
+        void detach();
+
         std::shared_ptr<ImageSourceImpl> m_impl;
     };
 
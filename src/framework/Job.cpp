@@ -12,14 +12,30 @@
 **********************************************************************************/
 #include "framework/Job.hpp"
 #include "framework/Logger.hpp"
+#include "framework/AlgorithmExceptions.hpp"
 
 #include <stdexcept>
 #include <iostream>
 
 namespace cloudcv {
 
+    v8::Local<v8::Value> CreateErrorObject(const std::string& message, const std::string& code)
+    {
+        Nan::EscapableHandleScope scope;
+
+        v8::Local<v8::Value> error = Nan::Error(message.c_str());
+        if (!code.empty())
+        {
+            Nan::Set(error.As<v8::Object>(), Nan::New("code").ToLocalChecked(), Nan::New(code).ToLocalChecked());
+        }
+
+        return scope.Escape(error);
+    }
+
     Job::Job(Nan::Callback *callback)
         : Nan::AsyncWorker(callback)
+        , m_admittedBytes(0)
+        , m_memoryLimit(0)
     {
     }
 
@@ -29,10 +45,32 @@ namespace cloudcv {
 
     void Job::Execute()
     {
+        const double queueTimeMs = queuedTimeMs();
+        RequestTimings::StageHistogram(RequestTimings::Queue).record(queueTimeMs);
+
+        if (m_timings)
+            m_timings->stageMs[RequestTimings::Queue] = queueTimeMs;
+
+        ScopedRequestTimings timings(m_timings.get());
+
+        MemoryAccount account(m_memoryLimit);
+        ScopedMemoryAccount accountScope(&account);
+
         try
         {
+            m_cancellation.throwIfCancelled();
             ExecuteNativeCode();
         }
+        catch (OperationCancelledException& e)
+        {
+            SetErrorMessage(e.what());
+            SetErrorCode(e.code());
+        }
+        catch (MemoryLimitExceededException& e)
+        {
+            SetErrorMessage(e.what());
+            SetErrorCode("ETOOLARGE");
+        }
         catch (cv::Exception& exc)
         {
             SetErrorMessage(exc.what());
@@ -41,18 +79,124 @@ namespace cloudcv {
         {
             SetErrorMessage(e.what());
         }
+        // Anything else escaping a pool thread would terminate the process
+        catch (std::exception& e)
+        {
+            SetErrorMessage(e.what());
+        }
+        catch (...)
+        {
+            SetErrorMessage("Unknown error");
+        }
+
+        // OpenCV decoders swallow exceptions of the allocator and report a generic failure
+        if (account.exceeded() && ErrorMessage() != nullptr)
+        {
+            SetErrorMessage(MemoryLimitExceededException(m_memoryLimit).what());
+            SetErrorCode("ETOOLARGE");
+        }
+
+        NativeMemory::Instance().recordJob(account);
     }
 
     void Job::HandleOKCallback()
     {
         Nan::HandleScope scope;
 
-        v8::Local<v8::Value> argv[] = {
-            Nan::Null(),
-            CreateCallbackResult()
-        };
+        InvokeCallback(callback, Nan::Null(), MarshalResult());
+    }
+
+    void Job::HandleErrorCallback()
+    {
+        Nan::HandleScope scope;
 
-        callback->Call(2, argv);
+        InvokeCallback(callback, CreateErrorObject(ErrorMessage(), m_errorCode), Nan::Null());
+    }
+
+    void Job::InvokeCallback(Nan::Callback * target, v8::Local<v8::Value> error, v8::Local<v8::Value> result)
+    {
+        Nan::HandleScope scope;
+
+        if (!m_timings)
+        {
+            v8::Local<v8::Value> argv[] = { error, result };
+            target->Call(2, argv);
+            return;
+        }
+
+        v8::Local<v8::Value> argv[] = { error, result, Nan::Marshal(*m_timings) };
+        target->Call(3, argv);
+    }
+
+    v8::Local<v8::Value> Job::MarshalResult()
+    {
+        Nan::EscapableHandleScope scope;
+
+        ScopedRequestTimings timings(m_timings.get());
+        ScopedStage stage(RequestTimings::Marshal);
+
+        return scope.Escape(CreateCallbackResult());
+    }
+
+    void Job::Reject(const std::string& errorMessage, const std::string& errorCode)
+    {
+        SetErrorMessage(errorMessage);
+        SetErrorCode(errorCode);
+    }
+
+    size_t Job::memoryEstimate() const
+    {
+        return 0;
+    }
+
+    void Job::markQueued(size_t admittedBytes, size_t memoryLimit)
+    {
+        m_memoryLimit = memoryLimit;
+        m_queueTimer = ScopedTimer();
+        m_admittedBytes = admittedBytes;
+    }
+
+    size_t Job::admittedBytes() const
+    {
+        return m_admittedBytes;
+    }
+
+    double Job::queuedTimeMs() const
+    {
+        return m_queueTimer.executionTimeMs();
+    }
+
+    void Job::setCancellationToken(const CancellationToken& token)
+    {
+        m_cancellation = token;
+    }
+
+    const CancellationToken& Job::cancellationToken() const
+    {
+        return m_cancellation;
+    }
+
+    CancellationToken& Job::cancellationToken()
+    {
+        return m_cancellation;
+    }
+
+    RequestTimings& Job::enableTimings()
+    {
+        if (!m_timings)
+            m_timings.reset(new RequestTimings());
+
+        return *m_timings;
+    }
+
+    void Job::SetErrorCode(const std::string& errorCode)
+    {
+        m_errorCode = errorCode;
+    }
+
+    const std::string& Job::ErrorCode() const
+    {
+        return m_errorCode;
     }
 
     void Job::SetErrorMessage(const std::string& errorMessage)
@@ -15,9 +15,19 @@
 #include <node.h>
 #include <v8.h>
 #include <nan.h>
+#include <memory>
+#include <string>
+
+#include "framework/ScopedTimer.hpp"
+#include "framework/CancellationToken.hpp"
+#include "framework/RequestTimings.hpp"
+#include "framework/NativeMemory.hpp"
 
 namespace cloudcv {
 
+    //! Creates JS Error with optional "code" property. Must be called from the V8 thread.
+    v8::Local<v8::Value> CreateErrorObject(const std::string& message, const std::string& code);
+
     /**
      * @brief A base class for asynchronous task running in worker pool
      */
@@ -31,13 +41,72 @@ namespace cloudcv {
 
         virtual void HandleOKCallback() override;
 
+        //! Passes error to the callback. Error object gets "code" property if error code was set.
+        virtual void HandleErrorCallback() override;
+
+        /**
+         * @brief Fails the job without executing it. The callback is not invoked 
+         *        here; the thread pool delivers the error on the next loop turn.
+         */
+        void Reject(const std::string& errorMessage, const std::string& errorCode);
+
+        /**
+         * @brief Estimated amount of memory the job needs while it is queued and running.
+         *        Admission only counts the inputs (encoded and decoded images); outputs 
+         *        and intermediate matrices depend on the kernel and are not known up front.
+         *        They are bounded while the job runs by its MemoryAccount limit instead.
+         */
+        virtual size_t memoryEstimate() const;
+
+        /**
+         * @brief Marks the moment job was admitted to the queue with given memory estimate.
+         *        Matrices the job allocates while executing are limited to memoryLimit bytes (zero is unlimited).
+         */
+        void markQueued(size_t admittedBytes, size_t memoryLimit);
+
+        //! Memory estimate the job was admitted with
+        size_t admittedBytes() const;
+
+        //! Time spent since the job was put into the queue
+        double queuedTimeMs() const;
+
+        //! Job is skipped with ECANCELED/ETIMEDOUT error if token fires before execution
+        void setCancellationToken(const CancellationToken& token);
+
+        const CancellationToken& cancellationToken() const;
+
+        CancellationToken& cancellationToken();
+
+        /**
+         * @brief Starts collecting stage timings of this job. They are passed to 
+         *        the callback as the third argument. Returns the timings so the 
+         *        caller can record stages that happened before the job was queued.
+         */
+        RequestTimings& enableTimings();
+
     protected:
         void SetErrorMessage(const std::string& errorMessage);
+
+        void SetErrorCode(const std::string& errorCode);
+
+        const std::string& ErrorCode() const;
+
+        //! Calls target with (error, result) and stage timings if they were requested
+        void InvokeCallback(Nan::Callback * target, v8::Local<v8::Value> error, v8::Local<v8::Value> result);
+
+        //! Creates result object of the job and accounts the time as marshalling stage
+        v8::Local<v8::Value> MarshalResult();
         
         virtual void ExecuteNativeCode() = 0;
 
 		virtual v8::Local<v8::Value> CreateCallbackResult() = 0;
 
     private:
+        std::string m_errorCode;
+        ScopedTimer m_queueTimer;
+        size_t      m_admittedBytes;
+        size_t      m_memoryLimit;
+        CancellationToken m_cancellation;
+        std::unique_ptr<RequestTimings> m_timings;
     };
 }
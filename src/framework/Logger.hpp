@@ -4,24 +4,10 @@
 #include <array>
 #include <iostream>
 #include <iterator>
+#include <sstream>
 #include <opencv2/opencv.hpp>
 
-struct FunctionTraceLoggerCookie
-{
-    FunctionTraceLoggerCookie(const char * name) 
-    : mName(name) 
-    {
-        std::clog << "Enter function: " << mName << std::endl;
-    }
-
-    ~FunctionTraceLoggerCookie()
-    {
-        std::clog << "Leave function: " << mName << std::endl;
-    }
-
-    const char * mName;
-};
-
+#include "framework/Tracer.hpp"
 
 template <typename T>
 inline std::ostream& operator<<(std::ostream& out, const std::vector<T>& v) {
@@ -41,17 +27,23 @@ inline std::ostream& operator<<(std::ostream& out, const cv::Rect_<T>& res) {
 }
 
 
-#if 0 && (defined(_DEBUG) || defined(DEBUG))
-    #if _MSC_VER
-        #define TRACE_FUNCTION FunctionTraceLoggerCookie(__FUNCTION__)
-    #else
-        #define TRACE_FUNCTION FunctionTraceLoggerCookie(__PRETTY_FUNCTION__)
-    #endif
+// Trace points record into the tracer only while it is running (see Tracer::start)
+#define CLOUDCV_TRACE_CONCAT_IMPL(a, b) a##b
+#define CLOUDCV_TRACE_CONCAT(a, b)      CLOUDCV_TRACE_CONCAT_IMPL(a, b)
 
-    #define LOG_TRACE_MESSAGE(x) std::cout << x << std::endl
+#if _MSC_VER
+    #define TRACE_FUNCTION cloudcv::TraceScope CLOUDCV_TRACE_CONCAT(traceScope, __LINE__)(__FUNCTION__)
 #else
-    #define TRACE_FUNCTION          static_cast<void>(0)
-    #define LOG_TRACE_MESSAGE(x)    static_cast<void>(0)
+    #define TRACE_FUNCTION cloudcv::TraceScope CLOUDCV_TRACE_CONCAT(traceScope, __LINE__)(__PRETTY_FUNCTION__)
 #endif
 
-
+#define LOG_TRACE_MESSAGE(x)                                    \
+    do                                                          \
+    {                                                           \
+        if (cloudcv::Tracer::Enabled())                         \
+        {                                                       \
+            std::ostringstream traceMessage;                    \
+            traceMessage << x;                                  \
+            cloudcv::Tracer::Instance().instant(traceMessage.str()); \
+        }                                                       \
+    } while (0)
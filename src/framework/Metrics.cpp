@@ -0,0 +1,215 @@
+/**********************************************************************************
+* CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+*                    This project lets you to quickly prototype a REST API
+*                    in a Node.js for a image processing service written in C++.
+*
+* Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+*
+* More information:
+*  - https://cloudcv.io
+*  - http://computer-vision-talks.com
+*
+**********************************************************************************/
+#include "framework/Metrics.hpp"
+#include "framework/AlgorithmInfo.hpp"
+#include "framework/ThreadPool.hpp"
+#include "framework/ImageCache.hpp"
+#include "framework/PooledMatAllocator.hpp"
+#include "framework/NativeMemory.hpp"
+#include "framework/RequestTimings.hpp"
+
+#include <sstream>
+#include <vector>
+
+namespace cloudcv
+{
+    namespace
+    {
+        //! Upper bounds of exported latency buckets in milliseconds
+        const std::vector<double>& LatencyBoundsMs()
+        {
+            static const std::vector<double> bounds = { 0.5, 1, 2.5, 5, 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 30000 };
+            return bounds;
+        }
+
+        class Exposition
+        {
+        public:
+            Exposition()
+            {
+                m_out.precision(9);
+            }
+
+            void family(const char * name, const char * type, const char * help)
+            {
+                m_out << "# HELP " << name << " " << help << "\n";
+                m_out << "# TYPE " << name << " " << type << "\n";
+            }
+
+            template <typename T>
+            void sample(const char * name, T value, const std::string& labels = std::string())
+            {
+                m_out << name;
+
+                if (!labels.empty())
+                    m_out << "{" << labels << "}";
+
+                m_out << " " << value << "\n";
+            }
+
+            template <typename T>
+            void metric(const char * name, const char * type, const char * help, T value)
+            {
+                family(name, type, help);
+                sample(name, value);
+            }
+
+            void histogram(const std::string& name, const std::string& labels, const LatencyHistogram& histogram)
+            {
+                const std::vector<double>& bounds = LatencyBoundsMs();
+                const LatencyHistogram::Cumulative cumulative = histogram.cumulative(bounds);
+                const std::string prefix = labels.empty() ? std::string() : labels + ",";
+
+                for (size_t i = 0; i < bounds.size(); i++)
+                {
+                    m_out << name << "_bucket{" << prefix << "le=\"" << bounds[i] / 1000.0 << "\"} " << cumulative.counts[i] << "\n";
+                }
+
+                m_out << name << "_bucket{" << prefix << "le=\"+Inf\"} " << cumulative.count << "\n";
+
+                sample((name + "_sum").c_str(), cumulative.sumMs / 1000.0, labels);
+                sample((name + "_count").c_str(), cumulative.count, labels);
+            }
+
+            std::string str() const
+            {
+                return m_out.str();
+            }
+
+        private:
+            std::ostringstream m_out;
+        };
+
+        std::string Label(const char * name, const std::string& value)
+        {
+            // Algorithm and stage names are identifiers, nothing to escape
+            return std::string(name) + "=\"" + value + "\"";
+        }
+
+        void WriteThreadPool(Exposition& out)
+        {
+            const ThreadPoolStatistics stats = ThreadPool::Instance().statistics();
+
+            out.metric("cloudcv_threads",                 "gauge",   "Worker threads of the native thread pool", stats.threads);
+            out.metric("cloudcv_queue_depth",             "gauge",   "Jobs waiting for a worker thread", stats.queued);
+            out.metric("cloudcv_queue_depth_limit",       "gauge",   "Queue depth above which jobs are rejected", stats.maxQueueDepth);
+            out.metric("cloudcv_jobs_in_flight",          "gauge",   "Jobs queued or running", stats.inFlight);
+            out.metric("cloudcv_in_flight_bytes",         "gauge",   "Estimated memory of jobs in flight", stats.inFlightBytes);
+            out.metric("cloudcv_in_flight_bytes_limit",   "gauge",   "In-flight memory above which jobs are rejected", stats.maxInFlightBytes);
+            out.metric("cloudcv_queue_wait_seconds",      "gauge",   "Moving average of time jobs wait in the queue", stats.averageWaitMs / 1000.0);
+            out.metric("cloudcv_estimated_wait_seconds",  "gauge",   "Expected queue wait of a job submitted now", stats.estimatedWaitMs / 1000.0);
+            out.metric("cloudcv_jobs_completed_total",    "counter", "Jobs completed", stats.completed);
+            out.metric("cloudcv_jobs_rejected_total",     "counter", "Jobs rejected by admission control", stats.rejected);
+        }
+
+        void WriteAlgorithms(Exposition& out)
+        {
+            const auto& algorithms = AlgorithmInfo::Get();
+
+            std::vector<AlgorithmStats::Snapshot> snapshots;
+            std::vector<std::string> labels;
+
+            for (const auto& alg : algorithms)
+            {
+                snapshots.push_back(alg.second->statistics().snapshot());
+                labels.push_back(Label("algorithm", alg.first));
+            }
+
+            out.family("cloudcv_algorithm_calls_total", "counter", "Algorithm invocations");
+            for (size_t i = 0; i < snapshots.size(); i++)
+                out.sample("cloudcv_algorithm_calls_total", snapshots[i].calls, labels[i]);
+
+            out.family("cloudcv_algorithm_errors_total", "counter", "Algorithm invocations that failed");
+            for (size_t i = 0; i < snapshots.size(); i++)
+                out.sample("cloudcv_algorithm_errors_total", snapshots[i].errors, labels[i]);
+
+            out.family("cloudcv_algorithm_cancelled_total", "counter", "Algorithm invocations that were cancelled or timed out");
+            for (size_t i = 0; i < snapshots.size(); i++)
+                out.sample("cloudcv_algorithm_cancelled_total", snapshots[i].cancelled, labels[i]);
+
+            out.family("cloudcv_algorithm_input_bytes_total", "counter", "Memory of algorithm inputs");
+            for (size_t i = 0; i < snapshots.size(); i++)
+                out.sample("cloudcv_algorithm_input_bytes_total", snapshots[i].bytesIn, labels[i]);
+
+            out.family("cloudcv_algorithm_output_bytes_total", "counter", "Memory of algorithm outputs");
+            for (size_t i = 0; i < snapshots.size(); i++)
+                out.sample("cloudcv_algorithm_output_bytes_total", snapshots[i].bytesOut, labels[i]);
+
+            size_t index = 0;
+
+            out.family("cloudcv_algorithm_queue_seconds", "histogram", "Time jobs of the algorithm waited in the queue");
+            for (const auto& alg : algorithms)
+                out.histogram("cloudcv_algorithm_queue_seconds", labels[index++], alg.second->statistics().queueTime());
+
+            index = 0;
+
+            out.family("cloudcv_algorithm_execution_seconds", "histogram", "Time spent in the algorithm");
+            for (const auto& alg : algorithms)
+                out.histogram("cloudcv_algorithm_execution_seconds", labels[index++], alg.second->statistics().executionTime());
+        }
+
+        void WriteStages(Exposition& out)
+        {
+            out.family("cloudcv_stage_seconds", "histogram", "Time requests spent in each processing stage, excluding nested stages");
+
+            for (int i = 0; i < RequestTimings::StageCount; i++)
+            {
+                const RequestTimings::Stage stage = static_cast<RequestTimings::Stage>(i);
+                out.histogram("cloudcv_stage_seconds", Label("stage", RequestTimings::StageName(stage)), RequestTimings::StageHistogram(stage));
+            }
+        }
+
+        void WriteCaches(Exposition& out)
+        {
+            const ImageCache::Statistics cache = ImageCache::Instance().statistics();
+
+            out.metric("cloudcv_image_cache_hits_total",      "counter", "Decoded images served from the image cache", cache.hits);
+            out.metric("cloudcv_image_cache_misses_total",    "counter", "Image cache lookups that had to decode", cache.misses);
+            out.metric("cloudcv_image_cache_evictions_total", "counter", "Images evicted from the image cache", cache.evictions);
+            out.metric("cloudcv_image_cache_entries",         "gauge",   "Images in the image cache", cache.entries);
+            out.metric("cloudcv_image_cache_bytes",           "gauge",   "Memory of images in the image cache", cache.bytes);
+            out.metric("cloudcv_image_cache_budget_bytes",    "gauge",   "Memory budget of the image cache", cache.budget);
+
+            const PooledMatAllocator::Statistics pool = PooledMatAllocator::Instance().statistics();
+
+            out.metric("cloudcv_mat_pool_hits_total",      "counter", "Matrix buffers served from the pool", pool.hits);
+            out.metric("cloudcv_mat_pool_misses_total",    "counter", "Poolable matrix buffers allocated from the system", pool.misses);
+            out.metric("cloudcv_mat_pool_overflows_total", "counter", "Matrix buffers freed because the pool was full", pool.overflows);
+            out.metric("cloudcv_mat_pool_bytes",           "gauge",   "Idle memory kept in the matrix pool", pool.bytesPooled);
+        }
+
+        void WriteMemory(Exposition& out)
+        {
+            const NativeMemory::Statistics memory = NativeMemory::Instance().statistics();
+
+            out.metric("cloudcv_native_bytes",                  "gauge",   "Memory of live matrices", memory.bytesInUse);
+            out.metric("cloudcv_native_peak_bytes",             "gauge",   "Largest memory of live matrices", memory.peakBytesInUse);
+            out.metric("cloudcv_native_external_bytes",         "gauge",   "Native memory last reported to V8", memory.externalBytes);
+            out.metric("cloudcv_job_peak_bytes",                "gauge",   "Largest matrix memory held by a single job", memory.peakJobBytes);
+            out.metric("cloudcv_jobs_over_memory_limit_total",  "counter", "Jobs that failed because they exceeded per-job memory limit", memory.jobsOverLimit);
+        }
+    }
+
+    std::string PrometheusMetrics()
+    {
+        Exposition out;
+
+        WriteThreadPool(out);
+        WriteAlgorithms(out);
+        WriteStages(out);
+        WriteCaches(out);
+        WriteMemory(out);
+
+        return out.str();
+    }
+}
@@ -0,0 +1,28 @@
+/**********************************************************************************
+* CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+*                    This project lets you to quickly prototype a REST API
+*                    in a Node.js for a image processing service written in C++.
+*
+* Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+*
+* More information:
+*  - https://cloudcv.io
+*  - http://computer-vision-talks.com
+*
+**********************************************************************************/
+#pragma once
+
+#include <string>
+
+namespace cloudcv
+{
+    /**
+     * @brief   Renders native counters in Prometheus text exposition format.
+     * @details Covers thread pool load, per-algorithm calls and latency histograms, 
+     *          time per processing stage, image cache and Mat allocator hit counters 
+     *          and native memory. Counters are read with relaxed atomic loads; queue 
+     *          and cache statistics take their locks only for a few reads, so 
+     *          scraping does not hold up worker threads. V8 thread only.
+     */
+    std::string PrometheusMetrics();
+}
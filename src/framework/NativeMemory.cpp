@@ -0,0 +1,201 @@
+/**********************************************************************************
+* CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+*                    This project lets you to quickly prototype a REST API
+*                    in a Node.js for a image processing service written in C++.
+*
+* Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+*
+* More information:
+*  - https://cloudcv.io
+*  - http://computer-vision-talks.com
+*
+**********************************************************************************/
+#include "framework/NativeMemory.hpp"
+#include "framework/PooledMatAllocator.hpp"
+#include "framework/AlgorithmExceptions.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace cloudcv
+{
+    namespace
+    {
+        thread_local MemoryAccount * CurrentAccount = nullptr;
+    }
+
+    struct MemoryAccount::Ledger
+    {
+        explicit Ledger(size_t limit_)
+            : limit(limit_)
+            , current(0)
+            , peak(0)
+            , exceeded(false)
+            , allocations(0)
+            , allocatedBytes(0)
+            , references(1)
+        {
+        }
+
+        void unref()
+        {
+            if (references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                delete this;
+        }
+
+        size_t                limit;
+        std::atomic<int64_t>  current;
+        std::atomic<int64_t>  peak;
+        std::atomic<bool>     exceeded;
+        std::atomic<uint64_t> allocations;
+        std::atomic<uint64_t> allocatedBytes;
+
+        //! The account itself and every allocation charged with a handle
+        std::atomic<size_t>   references;
+    };
+
+    MemoryAccount::MemoryAccount(size_t limit)
+        : m_ledger(new Ledger(limit))
+    {
+    }
+
+    MemoryAccount::~MemoryAccount()
+    {
+        m_ledger->unref();
+    }
+
+    void MemoryAccount::allocate(size_t bytes)
+    {
+        Ledger& ledger = *m_ledger;
+
+        const int64_t size = static_cast<int64_t>(bytes);
+        const int64_t current = ledger.current.fetch_add(size, std::memory_order_relaxed) + size;
+
+        if (ledger.limit > 0 && current > static_cast<int64_t>(ledger.limit))
+        {
+            ledger.current.fetch_sub(size, std::memory_order_relaxed);
+            ledger.exceeded = true;
+            throw MemoryLimitExceededException(ledger.limit);
+        }
+
+        ledger.allocations.fetch_add(1, std::memory_order_relaxed);
+        ledger.allocatedBytes.fetch_add(bytes, std::memory_order_relaxed);
+
+        int64_t peak = ledger.peak.load(std::memory_order_relaxed);
+        while (current > peak && !ledger.peak.compare_exchange_weak(peak, current, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    void * MemoryAccount::charge(size_t bytes)
+    {
+        allocate(bytes);
+        m_ledger->references.fetch_add(1, std::memory_order_relaxed);
+        return m_ledger;
+    }
+
+    void MemoryAccount::Discharge(void * handle, size_t bytes)
+    {
+        Ledger * ledger = static_cast<Ledger*>(handle);
+
+        // Nobody reads the counters once the account is gone, so this is harmless then
+        ledger->current.fetch_sub(static_cast<int64_t>(bytes), std::memory_order_relaxed);
+        ledger->unref();
+    }
+
+    size_t MemoryAccount::peak() const
+    {
+        return static_cast<size_t>(m_ledger->peak.load(std::memory_order_relaxed));
+    }
+
+    bool MemoryAccount::exceeded() const
+    {
+        return m_ledger->exceeded;
+    }
+
+    uint64_t MemoryAccount::allocations() const
+    {
+        return m_ledger->allocations.load(std::memory_order_relaxed);
+    }
+
+    uint64_t MemoryAccount::allocatedBytes() const
+    {
+        return m_ledger->allocatedBytes.load(std::memory_order_relaxed);
+    }
+
+    MemoryAccount * MemoryAccount::Current()
+    {
+        return CurrentAccount;
+    }
+
+    ScopedMemoryAccount::ScopedMemoryAccount(MemoryAccount * account)
+        : m_previous(CurrentAccount)
+    {
+        CurrentAccount = account;
+    }
+
+    ScopedMemoryAccount::~ScopedMemoryAccount()
+    {
+        CurrentAccount = m_previous;
+    }
+
+    NativeMemory& NativeMemory::Instance()
+    {
+        static NativeMemory instance;
+        return instance;
+    }
+
+    NativeMemory::NativeMemory()
+        : m_externalBytes(0)
+        , m_peakJobBytes(0)
+        , m_jobsOverLimit(0)
+    {
+    }
+
+    void NativeMemory::reportExternalMemory()
+    {
+        const PooledMatAllocator::Statistics allocator = PooledMatAllocator::Instance().statistics();
+        const int64_t current = static_cast<int64_t>(allocator.bytesInUse + allocator.bytesPooled);
+
+        int64_t change = current - m_externalBytes;
+        if (change == 0)
+            return;
+
+        // Nan::AdjustExternalMemory takes int, report large changes in steps
+        while (change != 0)
+        {
+            const int64_t step = std::max<int64_t>(std::numeric_limits<int>::min(), std::min<int64_t>(std::numeric_limits<int>::max(), change));
+            Nan::AdjustExternalMemory(static_cast<int>(step));
+            change -= step;
+        }
+
+        m_externalBytes = current;
+    }
+
+    void NativeMemory::recordJob(const MemoryAccount& account)
+    {
+        size_t peak = m_peakJobBytes.load(std::memory_order_relaxed);
+        while (account.peak() > peak && !m_peakJobBytes.compare_exchange_weak(peak, account.peak(), std::memory_order_relaxed))
+        {
+        }
+
+        if (account.exceeded())
+            m_jobsOverLimit++;
+    }
+
+    NativeMemory::Statistics NativeMemory::statistics() const
+    {
+        const PooledMatAllocator::Statistics allocator = PooledMatAllocator::Instance().statistics();
+
+        Statistics stats;
+
+        stats.bytesInUse     = allocator.bytesInUse;
+        stats.peakBytesInUse = allocator.peakBytesInUse;
+        stats.bytesPooled    = allocator.bytesPooled;
+        stats.externalBytes  = static_cast<size_t>(m_externalBytes);
+        stats.peakJobBytes   = m_peakJobBytes.load(std::memory_order_relaxed);
+        stats.jobsOverLimit  = m_jobsOverLimit.load(std::memory_order_relaxed);
+
+        return stats;
+    }
+}
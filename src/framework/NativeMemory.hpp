@@ -0,0 +1,163 @@
+/**********************************************************************************
+* CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+*                    This project lets you to quickly prototype a REST API
+*                    in a Node.js for a image processing service written in C++.
+*
+* Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+*
+* More information:
+*  - https://cloudcv.io
+*  - http://computer-vision-talks.com
+*
+**********************************************************************************/
+#pragma once
+
+#include <nan.h>
+#include <nan-marshal.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace cloudcv
+{
+    /**
+     * @brief   Matrix memory allocated by one job on the thread that runs it.
+     * @details Allocations of the pooled Mat allocator are charged to the account 
+     *          that is current for the calling thread. An allocation that would 
+     *          exceed the limit throws MemoryLimitExceededException instead, so 
+     *          an oversized job fails with an error rather than exhausting memory.
+     *          Frees are credited back to the account that allocated the memory, 
+     *          not to the job of the freeing thread; memory freed after the account 
+     *          is destroyed just drops its charge.
+     *          Thread-safe: helpers of ThreadPool::parallelFor share the account of their job.
+     */
+    class MemoryAccount
+    {
+    public:
+        //! Zero limit means unlimited
+        explicit MemoryAccount(size_t limit);
+        ~MemoryAccount();
+
+        void allocate(size_t bytes);
+
+        /**
+         * @brief Charges bytes like allocate() and returns handle the memory is released 
+         *        with. The handle stays valid after the account is destroyed.
+         */
+        void * charge(size_t bytes);
+
+        //! Releases memory charged with charge() and drops the handle
+        static void Discharge(void * handle, size_t bytes);
+
+        //! Largest amount of memory held at once
+        size_t peak() const;
+
+        //! True if an allocation was refused because of the limit
+        bool exceeded() const;
+
+        //! Number and total size of allocations charged to the account
+        uint64_t allocations() const;
+        uint64_t allocatedBytes() const;
+
+        //! Account of the job the calling thread works on, or null
+        static MemoryAccount * Current();
+
+    private:
+        MemoryAccount(const MemoryAccount&) = delete;
+        MemoryAccount& operator=(const MemoryAccount&) = delete;
+
+        //! Counters of the account, shared with allocations that are still alive
+        struct Ledger;
+
+        Ledger * m_ledger;
+    };
+
+    /**
+     * @brief Makes account current for the calling thread until the end of scope.
+     */
+    class ScopedMemoryAccount
+    {
+    public:
+        explicit ScopedMemoryAccount(MemoryAccount * account);
+        ~ScopedMemoryAccount();
+
+    private:
+        ScopedMemoryAccount(const ScopedMemoryAccount&) = delete;
+        ScopedMemoryAccount& operator=(const ScopedMemoryAccount&) = delete;
+
+        MemoryAccount * m_previous;
+    };
+
+    /**
+     * @brief   Accounting of native memory held by the addon.
+     * @details Decoded images, intermediate and output matrices live outside of the 
+     *          V8 heap. Their total is reported to V8 as external memory, so garbage 
+     *          collection takes into account native memory kept alive by JS objects.
+     */
+    class NativeMemory
+    {
+    public:
+        struct Statistics
+        {
+            //! Memory of live matrices
+            size_t   bytesInUse;
+            size_t   peakBytesInUse;
+
+            //! Idle memory kept by the Mat allocator for reuse
+            size_t   bytesPooled;
+
+            //! Amount last reported to V8 as external memory
+            size_t   externalBytes;
+
+            //! Largest amount of matrix memory held by a single job
+            size_t   peakJobBytes;
+
+            //! Jobs that failed because they exceeded per-job memory limit
+            uint64_t jobsOverLimit;
+        };
+
+        static NativeMemory& Instance();
+
+        //! Reports change of native memory since the last call to V8. V8 thread only.
+        void reportExternalMemory();
+
+        //! Called by a job when it finished executing
+        void recordJob(const MemoryAccount& account);
+
+        Statistics statistics() const;
+
+    private:
+        NativeMemory();
+
+        int64_t                  m_externalBytes;
+        std::atomic<size_t>      m_peakJobBytes;
+        std::atomic<uint64_t>    m_jobsOverLimit;
+    };
+}
+
+namespace Nan
+{
+    namespace marshal
+    {
+        using namespace cloudcv;
+
+        template<>
+        struct Serializer<NativeMemory::Statistics>
+        {
+            template<typename InputArchive>
+            static inline void load(InputArchive& ar, NativeMemory::Statistics& val) = delete;
+
+            template<typename OutputArchive>
+            static inline void save(OutputArchive& ar, const NativeMemory::Statistics& val)
+            {
+                ar & make_nvp("bytesInUse",     static_cast<double>(val.bytesInUse));
+                ar & make_nvp("peakBytesInUse", static_cast<double>(val.peakBytesInUse));
+                ar & make_nvp("bytesPooled",    static_cast<double>(val.bytesPooled));
+                ar & make_nvp("externalBytes",  static_cast<double>(val.externalBytes));
+                ar & make_nvp("peakJobBytes",   static_cast<double>(val.peakJobBytes));
+                ar & make_nvp("jobsOverLimit",  static_cast<double>(val.jobsOverLimit));
+            }
+        };
+    }
+}
@@ -0,0 +1,357 @@
+/**********************************************************************************
+* CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+*                    This project lets you to quickly prototype a REST API
+*                    in a Node.js for a image processing service written in C++.
+*
+* Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+*
+* More information:
+*  - https://cloudcv.io
+*  - http://computer-vision-talks.com
+*
+**********************************************************************************/
+#include "framework/Pipeline.hpp"
+#include "framework/Job.hpp"
+#include "framework/Logger.hpp"
+#include "framework/ThreadPool.hpp"
+
+#include <node_buffer.h>
+
+#include <algorithm>
+#include <exception>
+#include <set>
+#include <stdexcept>
+
+namespace cloudcv
+{
+    struct PipelineStep
+    {
+        std::string      name;
+        AlgorithmInfoPtr info;
+        AlgorithmPtr     algorithm;
+        ArgumentBindings input;
+        ArgumentBindings output;
+
+        //! Steps of the same level do not depend on each other
+        size_t           level;
+    };
+
+    struct PipelineOutput
+    {
+        size_t           step;
+        size_t           slot;
+        std::string      argument;
+    };
+
+    struct PipelineGraph
+    {
+        std::vector<PipelineStep>        steps;
+        std::vector<PipelineOutput>      outputs;
+
+        //! Bindings of literal values and pipeline inputs
+        std::vector<ParameterBindingPtr> sources;
+    };
+
+    namespace
+    {
+        v8::Local<v8::Value> GetProperty(v8::Local<v8::Object> object, const char * name)
+        {
+            return Nan::Get(object, Nan::New(name).ToLocalChecked()).ToLocalChecked();
+        }
+
+        std::string GetStringProperty(v8::Local<v8::Object> object, const char * name, const std::string& context)
+        {
+            v8::Local<v8::Value> value = GetProperty(object, name);
+
+            if (!value->IsString())
+                throw std::invalid_argument(context + ": \"" + name + "\" must be a string");
+
+            return *Nan::Utf8String(value);
+        }
+
+        //! Returns true if value is { $ref: "target" }
+        bool IsReference(v8::Local<v8::Value> value, std::string& target)
+        {
+            if (!value->IsObject() || value->IsArray() || node::Buffer::HasInstance(value))
+                return false;
+
+            v8::Local<v8::Value> ref = GetProperty(value.As<v8::Object>(), "$ref");
+            if (!ref->IsString())
+                return false;
+
+            target = *Nan::Utf8String(ref);
+            return true;
+        }
+
+        PipelineGraph BuildPipeline(v8::Local<v8::Object> spec)
+        {
+            PipelineGraph graph;
+
+            v8::Local<v8::Value> inputsValue = GetProperty(spec, "inputs");
+            v8::Local<v8::Object> inputs = inputsValue->IsObject() ? inputsValue.As<v8::Object>() : Nan::New<v8::Object>();
+
+            v8::Local<v8::Value> stepsValue = GetProperty(spec, "steps");
+            if (!stepsValue->IsArray() || stepsValue.As<v8::Array>()->Length() == 0)
+                throw std::invalid_argument("Pipeline \"steps\" must be a non-empty array");
+
+            v8::Local<v8::Array> steps = stepsValue.As<v8::Array>();
+            std::map<std::string, size_t> stepIndex;
+            std::map<std::string, ParameterBindingPtr> boundInputs;
+
+            for (uint32_t i = 0; i < steps->Length(); i++)
+            {
+                v8::Local<v8::Value> stepValue = Nan::Get(steps, i).ToLocalChecked();
+                if (!stepValue->IsObject())
+                    throw std::invalid_argument("Pipeline step must be an object");
+
+                v8::Local<v8::Object> stepObject = stepValue.As<v8::Object>();
+
+                PipelineStep step;
+                step.name = GetStringProperty(stepObject, "name", "Pipeline step");
+                step.level = 0;
+
+                if (step.name.empty() || step.name.find('.') != std::string::npos)
+                    throw std::invalid_argument("Invalid step name \"" + step.name + "\"");
+
+                if (stepIndex.count(step.name))
+                    throw std::invalid_argument("Duplicate step name \"" + step.name + "\"");
+
+                const std::string algorithmName = GetStringProperty(stepObject, "algorithm", "Step " + step.name);
+                auto algorithm = AlgorithmInfo::Get().find(algorithmName);
+                if (algorithm == AlgorithmInfo::Get().end())
+                    throw std::invalid_argument("Step " + step.name + ": algorithm \"" + algorithmName + "\" not found");
+
+                AlgorithmInfoPtr info = algorithm->second;
+                step.info = info;
+                step.input = ArgumentBindings(info->inputSlots().size());
+                step.output = ArgumentBindings(info->outputSlots().size());
+
+                v8::Local<v8::Value> stepInputsValue = GetProperty(stepObject, "inputs");
+                v8::Local<v8::Object> stepInputs = stepInputsValue->IsObject() ? stepInputsValue.As<v8::Object>() : Nan::New<v8::Object>();
+
+                for (const auto& arg : info->inputSlots())
+                {
+                    v8::Local<v8::Value> value = Nan::Get(stepInputs, info->inputPropertyName(arg->slot())).ToLocalChecked();
+                    ParameterBindingPtr binding;
+                    std::string ref;
+
+                    if (!IsReference(value, ref))
+                    {
+                        binding = arg->bind(value);
+                        graph.sources.push_back(binding);
+                    }
+                    else if (ref.find('.') == std::string::npos)
+                    {
+                        v8::Local<v8::String> key = Nan::New(ref).ToLocalChecked();
+                        if (!Nan::Has(inputs, key).FromJust())
+                            throw std::invalid_argument("Step " + step.name + ": unknown pipeline input \"" + ref + "\"");
+
+                        v8::Local<v8::Value> inputValue = Nan::Get(inputs, key).ToLocalChecked();
+                        auto shared = boundInputs.find(ref);
+
+                        if (shared != boundInputs.end() && shared->second->type() == arg->type())
+                        {
+                            binding = arg->bindShared(shared->second, inputValue);
+                        }
+                        else
+                        {
+                            binding = arg->bind(inputValue);
+                            boundInputs.insert(std::make_pair(ref, binding));
+                        }
+
+                        graph.sources.push_back(binding);
+                    }
+                    else
+                    {
+                        const std::string producerName = ref.substr(0, ref.find('.'));
+                        const std::string outputName = ref.substr(ref.find('.') + 1);
+
+                        auto producer = stepIndex.find(producerName);
+                        if (producer == stepIndex.end())
+                            throw std::invalid_argument("Step " + step.name + ": step \"" + producerName + "\" must be declared before it is referenced");
+
+                        const PipelineStep& source = graph.steps[producer->second];
+                        auto output = source.info->outputArguments().find(outputName);
+                        if (output == source.info->outputArguments().end())
+                            throw std::invalid_argument("Step " + step.name + ": step \"" + producerName + "\" has no output \"" + outputName + "\"");
+
+                        binding = source.output[output->second->slot()];
+                        if (binding->type() != arg->type())
+                            throw ArgumentTypeMismatchException(arg->name(), binding->type(), arg->type());
+
+                        step.level = std::max(step.level, source.level + 1);
+                    }
+
+                    step.input[arg->slot()] = binding;
+                }
+
+                for (const auto& arg : info->outputSlots())
+                {
+                    step.output[arg->slot()] = arg->bind();
+                }
+
+                step.algorithm = info->create();
+
+                stepIndex.insert(std::make_pair(step.name, graph.steps.size()));
+                graph.steps.push_back(step);
+            }
+
+            v8::Local<v8::Value> outputsValue = GetProperty(spec, "outputs");
+            if (!outputsValue->IsArray() || outputsValue.As<v8::Array>()->Length() == 0)
+                throw std::invalid_argument("Pipeline \"outputs\" must be a non-empty array");
+
+            v8::Local<v8::Array> outputs = outputsValue.As<v8::Array>();
+
+            for (uint32_t i = 0; i < outputs->Length(); i++)
+            {
+                v8::Local<v8::Value> outputValue = Nan::Get(outputs, i).ToLocalChecked();
+                const std::string ref = outputValue->IsString() ? *Nan::Utf8String(outputValue) : "";
+                const size_t dot = ref.find('.');
+
+                auto step = dot == std::string::npos ? stepIndex.end() : stepIndex.find(ref.substr(0, dot));
+                if (step == stepIndex.end())
+                    throw std::invalid_argument("Unknown pipeline output \"" + ref + "\"");
+
+                const auto& stepOutputs = graph.steps[step->second].info->outputArguments();
+                auto argument = stepOutputs.find(ref.substr(dot + 1));
+                if (argument == stepOutputs.end())
+                    throw std::invalid_argument("Unknown pipeline output \"" + ref + "\"");
+
+                PipelineOutput output;
+                output.step = step->second;
+                output.slot = argument->second->slot();
+                output.argument = argument->first;
+                graph.outputs.push_back(output);
+            }
+
+            return graph;
+        }
+    }
+
+    class PipelineTask : public Job
+    {
+        PipelineGraph  m_graph;
+        ProcessOptions m_options;
+
+    public:
+
+        PipelineTask(const PipelineGraph& graph, const ProcessOptions& options, Nan::Callback * callback)
+            : Job(callback)
+            , m_graph(graph)
+            , m_options(options)
+        {
+            TRACE_FUNCTION;
+            setCancellationToken(options.cancellation);
+        }
+
+        size_t memoryEstimate() const override
+        {
+            // The same image may feed several steps
+            std::set<ParameterBinding*> unique;
+            size_t bytes = 0;
+
+            for (const auto& binding : m_graph.sources)
+            {
+                if (unique.insert(binding.get()).second)
+                    bytes += binding->memoryEstimate();
+            }
+
+            return bytes;
+        }
+
+    protected:
+
+        void ExecuteNativeCode() override
+        {
+            TRACE_FUNCTION;
+
+            size_t levels = 0;
+            for (const auto& step : m_graph.steps)
+                levels = std::max(levels, step.level + 1);
+
+            for (size_t level = 0; level < levels; level++)
+            {
+                std::vector<PipelineStep*> stage;
+                for (auto& step : m_graph.steps)
+                {
+                    if (step.level == level)
+                        stage.push_back(&step);
+                }
+
+                std::vector<std::exception_ptr> errors(stage.size());
+
+                ThreadPool::Instance().parallelFor(stage.size(), [this, &stage, &errors](size_t index)
+                {
+                    try
+                    {
+                        PipelineStep * step = stage[index];
+                        LOG_TRACE_MESSAGE("Running pipeline step " << step->name);
+
+                        cancellationToken().throwIfCancelled();
+                        step->algorithm->setCancellationToken(&cancellationToken());
+                        RunAlgorithm(*step->info, *step->algorithm, step->input, step->output, queuedTimeMs());
+                    }
+                    catch (...)
+                    {
+                        errors[index] = std::current_exception();
+                    }
+                });
+
+                for (const auto& error : errors)
+                {
+                    if (error)
+                        std::rethrow_exception(error);
+                }
+            }
+        }
+
+        v8::Local<v8::Value> CreateCallbackResult() override
+        {
+            TRACE_FUNCTION;
+
+            Nan::EscapableHandleScope scope;
+
+            v8::Local<v8::Object> result = Nan::New<v8::Object>();
+
+            for (const auto& output : m_graph.outputs)
+            {
+                const PipelineStep& step = m_graph.steps[output.step];
+                v8::Local<v8::String> stepName = Nan::New(step.name).ToLocalChecked();
+
+                if (!Nan::Has(result, stepName).FromJust())
+                    Nan::Set(result, stepName, Nan::New<v8::Object>());
+
+                v8::Local<v8::Object> stepResult = Nan::Get(result, stepName).ToLocalChecked().As<v8::Object>();
+                const ParameterBindingPtr& binding = step.output[output.slot];
+
+                auto value = m_options.packed ? binding->marshalPackedFromNative() : binding->marshalFromNative();
+                Nan::Set(stepResult, Nan::New(output.argument).ToLocalChecked(), value);
+            }
+
+            return scope.Escape(result);
+        }
+    };
+
+    void ProcessPipeline(v8::Local<v8::Object> spec, const ProcessOptions& options, v8::Local<v8::Function> resultsCallback)
+    {
+        TRACE_FUNCTION;
+        Nan::HandleScope scope;
+
+        PipelineGraph graph;
+
+        try
+        {
+            graph = BuildPipeline(spec);
+        }
+        catch (std::exception& er)
+        {
+            LOG_TRACE_MESSAGE(er.what());
+            v8::Local<v8::Value> argv[] = { CreateErrorObject(er.what(), ""), Nan::Null() };
+            Nan::Callback(resultsCallback).Call(2, argv);
+            return;
+        }
+
+        Nan::Callback * callback = new Nan::Callback(resultsCallback);
+        ThreadPool::Instance().enqueue(new PipelineTask(graph, options, callback));
+    }
+}
@@ -0,0 +1,42 @@
+/**********************************************************************************
+* CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+*                    This project lets you to quickly prototype a REST API
+*                    in a Node.js for a image processing service written in C++.
+*
+* Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+*
+* More information:
+*  - https://cloudcv.io
+*  - http://computer-vision-talks.com
+*
+**********************************************************************************/
+#pragma once
+
+#include <node.h>
+#include <v8.h>
+#include <nan.h>
+
+#include "framework/Algorithm.hpp"
+
+namespace cloudcv
+{
+    /**
+     * @brief Runs a small graph of registered algorithms as a single job.
+     *
+     * Pipeline specification:
+     * {
+     *   inputs:  { image: <Buffer or path> },
+     *   steps:   [
+     *     { name: "integral", algorithm: "integralImage", inputs: { image: { $ref: "image" } } },
+     *     { name: "lines",    algorithm: "houghLines",    inputs: { image: { $ref: "image" }, threshold: 100 } }
+     *   ],
+     *   outputs: [ "integral.integralImage", "lines.lines" ]
+     * }
+     *
+     * Step inputs are literal values or references: { $ref: "input" } to a pipeline input or 
+     * { $ref: "step.output" } to an output of a step declared earlier. Images referenced by several 
+     * steps are decoded once. Steps that do not depend on each other run in parallel. 
+     * Only listed outputs are marshalled back; callback receives { step: { output: value } }.
+     */
+    void ProcessPipeline(v8::Local<v8::Object> spec, const ProcessOptions& options, v8::Local<v8::Function> resultsCallback);
+}
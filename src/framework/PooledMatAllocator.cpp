@@ -0,0 +1,342 @@
+/**********************************************************************************
+* CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+*                    This project lets you to quickly prototype a REST API
+*                    in a Node.js for a image processing service written in C++.
+*
+* Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+*
+* More information:
+*  - https://cloudcv.io
+*  - http://computer-vision-talks.com
+*
+**********************************************************************************/
+#include "framework/PooledMatAllocator.hpp"
+#include "framework/NativeMemory.hpp"
+
+namespace cloudcv
+{
+    namespace
+    {
+        const int    MinShift     = 16; // log2(MinPooledSize)
+        const int    MaxShift     = 26; // log2(MaxPooledSize)
+        const int    SubClasses   = 4;  // Size classes per power of two
+        const size_t ClassCount   = (MaxShift - MinShift) * SubClasses + 1;
+
+        //! Number of buffers per size class kept in a thread cache
+        const size_t ThreadCacheBlocks = 2;
+
+        bool IsPooled(size_t size)
+        {
+            return size >= PooledMatAllocator::MinPooledSize && size <= PooledMatAllocator::MaxPooledSize;
+        }
+
+        /**
+         * Maps poolable size to size class. Class 0 is MinPooledSize, then every
+         * range (2^s, 2^(s+1)] is split into four classes of equal step.
+         */
+        size_t SizeClass(size_t size, size_t& blockSize)
+        {
+            if (size <= PooledMatAllocator::MinPooledSize)
+            {
+                blockSize = PooledMatAllocator::MinPooledSize;
+                return 0;
+            }
+
+            int shift = MinShift;
+            while ((size_t(1) << (shift + 1)) < size)
+                shift++;
+
+            const size_t base = size_t(1) << shift;
+            const size_t step = base / SubClasses;
+            const size_t index = (size - base + step - 1) / step; // 1..SubClasses
+
+            blockSize = base + index * step;
+            return 1 + (shift - MinShift) * SubClasses + (index - 1);
+        }
+
+        //! Size of buffers of given size class
+        size_t ClassBlockSize(size_t index)
+        {
+            if (index == 0)
+                return PooledMatAllocator::MinPooledSize;
+
+            const size_t base = size_t(1) << (MinShift + (index - 1) / SubClasses);
+            return base + ((index - 1) % SubClasses + 1) * (base / SubClasses);
+        }
+
+        //! Amount of memory actually allocated for a buffer of given size
+        size_t AllocationSize(size_t size)
+        {
+            size_t blockSize = size;
+
+            if (IsPooled(size))
+                SizeClass(size, blockSize);
+
+            return blockSize;
+        }
+    }
+
+    struct PooledMatAllocator::ThreadCache
+    {
+        ThreadCache()
+            : blocks(ClassCount)
+        {
+        }
+
+        std::vector< std::vector<uchar*> > blocks;
+    };
+
+    PooledMatAllocator& PooledMatAllocator::Instance()
+    {
+        // Never destroyed: matrices may be released by static destructors at exit
+        static PooledMatAllocator * instance = new PooledMatAllocator();
+        return *instance;
+    }
+
+    PooledMatAllocator::PooledMatAllocator()
+        : m_free(ClassCount)
+        , m_maxPooledBytes(DefaultMaxPooledBytes)
+        , m_bytesInUse(0)
+        , m_peakBytesInUse(0)
+        , m_bytesPooled(0)
+        , m_hits(0)
+        , m_misses(0)
+        , m_overflows(0)
+    {
+    }
+
+    PooledMatAllocator::ThreadCache * PooledMatAllocator::LocalCache()
+    {
+        // Plain thread-local pointers stay valid while the thread is exiting,
+        // the owner hands cached buffers over to the shared lists.
+        static thread_local ThreadCache * cache = nullptr;
+        static thread_local bool          exiting = false;
+
+        struct Owner
+        {
+            ~Owner()
+            {
+                if (cache != nullptr)
+                {
+                    Instance().flush(*cache);
+                    delete cache;
+                    cache = nullptr;
+                }
+
+                exiting = true;
+            }
+        };
+
+        if (exiting)
+            return nullptr;
+
+        static thread_local Owner owner;
+
+        if (cache == nullptr)
+            cache = new ThreadCache();
+
+        return cache;
+    }
+
+    // Mirrors cv::StdMatAllocator except for the source of the buffer
+    cv::UMatData* PooledMatAllocator::allocate(int dims, const int* sizes, int type, void* data0, size_t* step, int /*flags*/, cv::UMatUsageFlags /*usageFlags*/) const
+    {
+        size_t total = CV_ELEM_SIZE(type);
+
+        for (int i = dims - 1; i >= 0; i--)
+        {
+            if (step)
+            {
+                if (data0 && step[i] != CV_AUTOSTEP)
+                {
+                    CV_Assert(total <= step[i]);
+                    total = step[i];
+                }
+                else
+                {
+                    step[i] = total;
+                }
+            }
+
+            total *= sizes[i];
+        }
+
+        void * owner = nullptr;
+        uchar* data = data0 ? static_cast<uchar*>(data0) : acquireBlock(total, owner);
+
+        cv::UMatData* u = new cv::UMatData(this);
+        u->data = u->origdata = data;
+        u->size = total;
+        u->userdata = owner;
+
+        if (data0)
+            u->flags |= cv::UMatData::USER_ALLOCATED;
+
+        return u;
+    }
+
+    bool PooledMatAllocator::allocate(cv::UMatData* u, int /*accessFlags*/, cv::UMatUsageFlags /*usageFlags*/) const
+    {
+        return u != nullptr;
+    }
+
+    void PooledMatAllocator::deallocate(cv::UMatData* u) const
+    {
+        if (!u)
+            return;
+
+        CV_Assert(u->urefcount == 0);
+        CV_Assert(u->refcount == 0);
+
+        if (!(u->flags & cv::UMatData::USER_ALLOCATED))
+        {
+            releaseBlock(u->origdata, u->size, u->userdata);
+            u->origdata = 0;
+        }
+
+        delete u;
+    }
+
+    uchar * PooledMatAllocator::acquireBlock(size_t size, void *& owner) const
+    {
+        const size_t allocationSize = AllocationSize(size);
+
+        // Throws if the job would exceed its limit, before anything is allocated
+        MemoryAccount * account = MemoryAccount::Current();
+        owner = account != nullptr ? account->charge(allocationSize) : nullptr;
+
+        const size_t inUse = m_bytesInUse += allocationSize;
+
+        size_t peak = m_peakBytesInUse.load(std::memory_order_relaxed);
+        while (inUse > peak && !m_peakBytesInUse.compare_exchange_weak(peak, inUse, std::memory_order_relaxed))
+        {
+        }
+
+        if (!IsPooled(size))
+            return static_cast<uchar*>(cv::fastMalloc(size));
+
+        size_t blockSize;
+        const size_t index = SizeClass(size, blockSize);
+        uchar * block = nullptr;
+
+        ThreadCache * cache = LocalCache();
+        if (cache != nullptr && !cache->blocks[index].empty())
+        {
+            block = cache->blocks[index].back();
+            cache->blocks[index].pop_back();
+        }
+        else
+        {
+            std::lock_guard<std::mutex> guard(m_lock);
+
+            if (!m_free[index].empty())
+            {
+                block = m_free[index].back();
+                m_free[index].pop_back();
+            }
+        }
+
+        if (block != nullptr)
+        {
+            m_bytesPooled -= blockSize;
+            m_hits++;
+            return block;
+        }
+
+        m_misses++;
+        return static_cast<uchar*>(cv::fastMalloc(blockSize));
+    }
+
+    void PooledMatAllocator::releaseBlock(uchar * block, size_t size, void * owner) const
+    {
+        const size_t allocationSize = AllocationSize(size);
+        m_bytesInUse -= allocationSize;
+
+        // Credited to the job that allocated the block, whichever thread frees it
+        if (owner != nullptr)
+            MemoryAccount::Discharge(owner, allocationSize);
+
+        if (!IsPooled(size))
+        {
+            cv::fastFree(block);
+            return;
+        }
+
+        size_t blockSize;
+        const size_t index = SizeClass(size, blockSize);
+
+        // Reserve room in the pool first, so concurrent releases cannot exceed the cap
+        if (m_bytesPooled.fetch_add(blockSize) + blockSize > m_maxPooledBytes)
+        {
+            m_bytesPooled -= blockSize;
+            m_overflows++;
+            cv::fastFree(block);
+            return;
+        }
+
+        ThreadCache * cache = LocalCache();
+        if (cache != nullptr && cache->blocks[index].size() < ThreadCacheBlocks)
+        {
+            cache->blocks[index].push_back(block);
+            return;
+        }
+
+        std::lock_guard<std::mutex> guard(m_lock);
+        m_free[index].push_back(block);
+    }
+
+    void PooledMatAllocator::flush(ThreadCache& cache) const
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+
+        for (size_t index = 0; index < ClassCount; index++)
+        {
+            m_free[index].insert(m_free[index].end(), cache.blocks[index].begin(), cache.blocks[index].end());
+            cache.blocks[index].clear();
+        }
+    }
+
+    void PooledMatAllocator::setMaxPooledBytes(size_t bytes)
+    {
+        m_maxPooledBytes = bytes;
+
+        if (m_bytesPooled > bytes)
+            trim();
+    }
+
+    void PooledMatAllocator::trim()
+    {
+        ThreadCache * cache = LocalCache();
+        if (cache != nullptr)
+            flush(*cache);
+
+        std::lock_guard<std::mutex> guard(m_lock);
+
+        // Buffers in caches of other threads stay pooled until reused or the thread exits
+        for (size_t index = 0; index < ClassCount; index++)
+        {
+            for (uchar * block : m_free[index])
+            {
+                cv::fastFree(block);
+                m_bytesPooled -= ClassBlockSize(index);
+            }
+
+            m_free[index].clear();
+        }
+    }
+
+    PooledMatAllocator::Statistics PooledMatAllocator::statistics() const
+    {
+        Statistics stats;
+
+        stats.bytesInUse     = m_bytesInUse;
+        stats.peakBytesInUse = m_peakBytesInUse;
+        stats.bytesPooled    = m_bytesPooled;
+        stats.maxPooledBytes = m_maxPooledBytes;
+        stats.hits           = m_hits;
+        stats.misses         = m_misses;
+        stats.overflows      = m_overflows;
+
+        return stats;
+    }
+}
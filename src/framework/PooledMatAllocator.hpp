@@ -0,0 +1,134 @@
+/**********************************************************************************
+* CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+*                    This project lets you to quickly prototype a REST API
+*                    in a Node.js for a image processing service written in C++.
+*
+* Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+*
+* More information:
+*  - https://cloudcv.io
+*  - http://computer-vision-talks.com
+*
+**********************************************************************************/
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <nan.h>
+#include <nan-marshal.h>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace cloudcv
+{
+    /**
+     * @brief   cv::MatAllocator that recycles large matrix buffers.
+     * @details Buffers between MinPooledSize and MaxPooledSize are rounded up to 
+     *          size classes (four per power of two) and kept in free lists when 
+     *          released instead of going back to the system. Each thread has a 
+     *          small private cache per size class in front of the shared lists. 
+     *          Total amount of idle pooled memory is capped; smaller and larger 
+     *          buffers are allocated with cv::fastMalloc as usual.
+     *          The allocator is installed as default for all cv::Mat instances 
+     *          when the addon is loaded. Allocations are charged to the memory 
+     *          account of the job running on the calling thread, if any.
+     */
+    class PooledMatAllocator : public cv::MatAllocator
+    {
+    public:
+        struct Statistics
+        {
+            //! Memory of live matrices allocated by this allocator
+            size_t   bytesInUse;
+            size_t   peakBytesInUse;
+
+            //! Idle memory kept in free lists
+            size_t   bytesPooled;
+            size_t   maxPooledBytes;
+
+            //! Allocations served from free lists
+            uint64_t hits;
+
+            //! Poolable allocations that went to the system
+            uint64_t misses;
+
+            //! Buffers freed because the pool was full
+            uint64_t overflows;
+        };
+
+        static const size_t MinPooledSize = 64 * 1024;
+        static const size_t MaxPooledSize = 64 * 1024 * 1024;
+        static const size_t DefaultMaxPooledBytes = 256 * 1024 * 1024;
+
+        static PooledMatAllocator& Instance();
+
+        cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step, int flags, cv::UMatUsageFlags usageFlags) const override;
+
+        bool allocate(cv::UMatData* data, int accessFlags, cv::UMatUsageFlags usageFlags) const override;
+
+        void deallocate(cv::UMatData* data) const override;
+
+        //! Sets cap of idle pooled memory. Zero disables pooling.
+        void setMaxPooledBytes(size_t bytes);
+
+        //! Returns idle buffers of shared free lists and the calling thread to the system
+        void trim();
+
+        Statistics statistics() const;
+
+    private:
+        struct ThreadCache;
+
+        PooledMatAllocator();
+
+        //! Cache of the calling thread or null if the thread is exiting
+        static ThreadCache * LocalCache();
+
+        //! owner receives memory account handle of the block or null, see MemoryAccount::charge
+        uchar * acquireBlock(size_t size, void *& owner) const;
+
+        void releaseBlock(uchar * block, size_t size, void * owner) const;
+
+        void flush(ThreadCache& cache) const;
+
+        mutable std::mutex                 m_lock;
+        mutable std::vector< std::vector<uchar*> > m_free;
+
+        std::atomic<size_t>                m_maxPooledBytes;
+        mutable std::atomic<size_t>        m_bytesInUse;
+        mutable std::atomic<size_t>        m_peakBytesInUse;
+        mutable std::atomic<size_t>        m_bytesPooled;
+        mutable std::atomic<uint64_t>      m_hits;
+        mutable std::atomic<uint64_t>      m_misses;
+        mutable std::atomic<uint64_t>      m_overflows;
+    };
+}
+
+namespace Nan
+{
+    namespace marshal
+    {
+        using namespace cloudcv;
+
+        template<>
+        struct Serializer<PooledMatAllocator::Statistics>
+        {
+            template<typename InputArchive>
+            static inline void load(InputArchive& ar, PooledMatAllocator::Statistics& val) = delete;
+
+            template<typename OutputArchive>
+            static inline void save(OutputArchive& ar, const PooledMatAllocator::Statistics& val)
+            {
+                ar & make_nvp("bytesInUse",     static_cast<double>(val.bytesInUse));
+                ar & make_nvp("peakBytesInUse", static_cast<double>(val.peakBytesInUse));
+                ar & make_nvp("bytesPooled",    static_cast<double>(val.bytesPooled));
+                ar & make_nvp("maxPooledBytes", static_cast<double>(val.maxPooledBytes));
+                ar & make_nvp("hits",           static_cast<double>(val.hits));
+                ar & make_nvp("misses",         static_cast<double>(val.misses));
+                ar & make_nvp("overflows",      static_cast<double>(val.overflows));
+            }
+        };
+    }
+}
@@ -0,0 +1,90 @@
+/**********************************************************************************
+* CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+*                    This project lets you to quickly prototype a REST API
+*                    in a Node.js for a image processing service written in C++.
+*
+* Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+*
+* More information:
+*  - https://cloudcv.io
+*  - http://computer-vision-talks.com
+*
+**********************************************************************************/
+#include "framework/RequestTimings.hpp"
+
+namespace cloudcv
+{
+    namespace
+    {
+        thread_local RequestTimings * CurrentTimings = nullptr;
+        thread_local ScopedStage *    ActiveStage = nullptr;
+    }
+
+    RequestTimings::RequestTimings()
+    {
+        for (int i = 0; i < StageCount; i++)
+            stageMs[i] = 0;
+    }
+
+    double RequestTimings::totalMs() const
+    {
+        double total = 0;
+        for (int i = 0; i < StageCount; i++)
+            total += stageMs[i];
+        return total;
+    }
+
+    RequestTimings * RequestTimings::Current()
+    {
+        return CurrentTimings;
+    }
+
+    ScopedRequestTimings::ScopedRequestTimings(RequestTimings * timings)
+        : m_previous(CurrentTimings)
+    {
+        CurrentTimings = timings;
+    }
+
+    ScopedRequestTimings::~ScopedRequestTimings()
+    {
+        CurrentTimings = m_previous;
+    }
+
+    LatencyHistogram& RequestTimings::StageHistogram(Stage stage)
+    {
+        // Never destroyed: worker threads may finish stages during shutdown
+        static LatencyHistogram * histograms = new LatencyHistogram[StageCount];
+        return histograms[stage];
+    }
+
+    const char * RequestTimings::StageName(Stage stage)
+    {
+        static const char * names[StageCount] = { "bind", "queue", "decode", "convert", "kernel", "marshal" };
+        return names[stage];
+    }
+
+    ScopedStage::ScopedStage(RequestTimings::Stage stage)
+        : m_timings(CurrentTimings)
+        , m_parent(ActiveStage)
+        , m_stage(stage)
+        , m_nestedMs(0)
+    {
+        ActiveStage = this;
+    }
+
+    ScopedStage::~ScopedStage()
+    {
+        const double elapsed = m_timer.executionTimeMs();
+        const double exclusive = elapsed - m_nestedMs;
+
+        RequestTimings::StageHistogram(m_stage).record(exclusive);
+
+        if (m_timings != nullptr)
+            m_timings->stageMs[m_stage] += exclusive;
+
+        if (m_parent != nullptr)
+            m_parent->m_nestedMs += elapsed;
+
+        ActiveStage = m_parent;
+    }
+}
@@ -0,0 +1,125 @@
+/**********************************************************************************
+* CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+*                    This project lets you to quickly prototype a REST API
+*                    in a Node.js for a image processing service written in C++.
+*
+* Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+*
+* More information:
+*  - https://cloudcv.io
+*  - http://computer-vision-talks.com
+*
+**********************************************************************************/
+#pragma once
+
+#include "framework/ScopedTimer.hpp"
+#include "framework/AlgorithmStats.hpp"
+
+#include <nan.h>
+#include <nan-marshal.h>
+
+namespace cloudcv
+{
+    /**
+     * @brief Breakdown of the time one request spent in each processing stage.
+     *        Collected only for requests that ask for it with the "timings" option.
+     */
+    struct RequestTimings
+    {
+        enum Stage
+        {
+            Bind,       //!< Converting JS arguments on the V8 thread
+            Queue,      //!< Waiting for a worker thread
+            Decode,     //!< Reading and decoding input images
+            Convert,    //!< Colour, depth and scale conversions of images
+            Kernel,     //!< The algorithm itself, without nested stages
+            Marshal,    //!< Converting results back to JS values
+
+            StageCount
+        };
+
+        RequestTimings();
+
+        double totalMs() const;
+
+        double stageMs[StageCount];
+
+        //! Timings of the request the calling thread works on, or null
+        static RequestTimings * Current();
+
+        /**
+         * @brief Distribution of time spent in the stage by all requests, 
+         *        whether they asked for timings or not. Thread-safe.
+         */
+        static LatencyHistogram& StageHistogram(Stage stage);
+
+        //! Lowercase name of the stage, as used in marshalled timings
+        static const char * StageName(Stage stage);
+    };
+
+    /**
+     * @brief Makes timings current for the calling thread until the end of scope.
+     */
+    class ScopedRequestTimings
+    {
+    public:
+        explicit ScopedRequestTimings(RequestTimings * timings);
+        ~ScopedRequestTimings();
+
+    private:
+        ScopedRequestTimings(const ScopedRequestTimings&) = delete;
+        ScopedRequestTimings& operator=(const ScopedRequestTimings&) = delete;
+
+        RequestTimings * m_previous;
+    };
+
+    /**
+     * @brief   Attributes time until the end of scope to a stage of the current request.
+     * @details Stages may nest; time of a nested stage is excluded from the enclosing one,
+     *          so stage times of a request add up. The time is always recorded in the 
+     *          stage histogram and also added to current timings of the calling thread, if any.
+     */
+    class ScopedStage
+    {
+    public:
+        explicit ScopedStage(RequestTimings::Stage stage);
+        ~ScopedStage();
+
+    private:
+        ScopedStage(const ScopedStage&) = delete;
+        ScopedStage& operator=(const ScopedStage&) = delete;
+
+        RequestTimings *      m_timings;
+        ScopedStage *         m_parent;
+        RequestTimings::Stage m_stage;
+        ScopedTimer           m_timer;
+        double                m_nestedMs;
+    };
+}
+
+namespace Nan
+{
+    namespace marshal
+    {
+        using namespace cloudcv;
+
+        template<>
+        struct Serializer<RequestTimings>
+        {
+            template<typename InputArchive>
+            static inline void load(InputArchive& ar, RequestTimings& val) = delete;
+
+            template<typename OutputArchive>
+            static inline void save(OutputArchive& ar, const RequestTimings& val)
+            {
+                ar & make_nvp("bind",    val.stageMs[RequestTimings::Bind]);
+                ar & make_nvp("queue",   val.stageMs[RequestTimings::Queue]);
+                ar & make_nvp("decode",  val.stageMs[RequestTimings::Decode]);
+                ar & make_nvp("convert", val.stageMs[RequestTimings::Convert]);
+                ar & make_nvp("kernel",  val.stageMs[RequestTimings::Kernel]);
+                ar & make_nvp("marshal", val.stageMs[RequestTimings::Marshal]);
+                ar & make_nvp("total",   val.totalMs());
+            }
+        };
+    }
+}
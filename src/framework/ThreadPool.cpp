@@ -0,0 +1,489 @@
+/**********************************************************************************
+* CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+*                    This project lets you to quickly prototype a REST API
+*                    in a Node.js for a image processing service written in C++.
+*
+* Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+*
+* More information:
+*  - https://cloudcv.io
+*  - http://computer-vision-talks.com
+*
+**********************************************************************************/
+#include "framework/ThreadPool.hpp"
+#include "framework/Job.hpp"
+#include "framework/NativeMemory.hpp"
+#include "framework/Logger.hpp"
+#include "framework/ScopedTimer.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+
+#if TARGET_PLATFORM_LINUX || TARGET_PLATFORM_MAC
+#include <pthread.h>
+#define CLOUDCV_USE_PTHREADS 1
+#else
+#define CLOUDCV_USE_PTHREADS 0
+#endif
+
+namespace cloudcv
+{
+    ThreadPoolOptions::ThreadPoolOptions()
+        : threads(0)
+        , stackSize(0)
+        , name("cloudcv")
+        , maxQueueDepth(256)
+        , maxInFlightBytes(1024 * 1024 * 1024)
+        , maxJobBytes(512 * 1024 * 1024)
+    {
+    }
+
+    const double ThreadPool::SmoothingFactor = 0.1;
+
+    namespace
+    {
+        size_t EffectiveThreads(const ThreadPoolOptions& options)
+        {
+            return options.threads > 0 ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+        }
+
+#if CLOUDCV_USE_PTHREADS
+        // Applies stack size to thread attributes. If the platform rejects it (e.g. below PTHREAD_STACK_MIN)
+        // destroys the attributes and throws.
+        void SetStackSize(pthread_attr_t& attributes, size_t stackSize)
+        {
+            if (stackSize > 0 && pthread_attr_setstacksize(&attributes, stackSize) != 0)
+            {
+                pthread_attr_destroy(&attributes);
+                throw std::runtime_error("Invalid thread stack size " + std::to_string(stackSize));
+            }
+        }
+#endif
+    }
+
+    /**
+     * @brief Worker thread with configurable stack size and name.
+     */
+    class ThreadPool::NativeThread
+    {
+    public:
+        NativeThread(std::function<void()> entry, size_t stackSize, const std::string& name)
+            : m_entry(entry)
+            , m_name(name.substr(0, 15)) // Linux limits thread names to 15 characters
+        {
+#if CLOUDCV_USE_PTHREADS
+            pthread_attr_t attributes;
+            pthread_attr_init(&attributes);
+
+            SetStackSize(attributes, stackSize);
+
+            int result = pthread_create(&m_handle, &attributes, &NativeThread::Run, this);
+            pthread_attr_destroy(&attributes);
+
+            if (result != 0)
+                throw std::runtime_error("Cannot create worker thread");
+#else
+            // Stack size cannot be changed for std::thread
+            m_handle = std::thread(&NativeThread::Run, this);
+#endif
+        }
+
+        void join()
+        {
+#if CLOUDCV_USE_PTHREADS
+            pthread_join(m_handle, nullptr);
+#else
+            m_handle.join();
+#endif
+        }
+
+    private:
+        static void * Run(void * arg)
+        {
+            NativeThread * self = static_cast<NativeThread*>(arg);
+
+#if TARGET_PLATFORM_LINUX
+            pthread_setname_np(pthread_self(), self->m_name.c_str());
+#elif TARGET_PLATFORM_MAC
+            pthread_setname_np(self->m_name.c_str());
+#endif
+            self->m_entry();
+            return nullptr;
+        }
+
+        std::function<void()> m_entry;
+        std::string           m_name;
+
+#if CLOUDCV_USE_PTHREADS
+        pthread_t             m_handle;
+#else
+        std::thread           m_handle;
+#endif
+    };
+
+    ThreadPool& ThreadPool::Instance()
+    {
+        static ThreadPool instance;
+        return instance;
+    }
+
+    ThreadPool::ThreadPool()
+        : m_stopping(false)
+        , m_averageWaitMs(0)
+        , m_averageRunMs(0)
+        , m_workerCount(0)
+        , m_asyncInitialized(false)
+        , m_inFlight(0)
+        , m_inFlightBytes(0)
+        , m_completedCount(0)
+        , m_rejectedCount(0)
+    {
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        stop();
+    }
+
+    bool ThreadPool::enqueue(Job * job)
+    {
+        TRACE_FUNCTION;
+
+        const size_t jobBytes = job->memoryEstimate();
+
+        size_t queued;
+        {
+            std::lock_guard<std::mutex> guard(m_queueLock);
+            queued = m_queue.size();
+        }
+
+        if (m_options.maxQueueDepth > 0 && queued >= m_options.maxQueueDepth)
+        {
+            reject(job, "Job queue is full", "EQUEUEFULL");
+            return false;
+        }
+
+        if (m_options.maxJobBytes > 0 && jobBytes > m_options.maxJobBytes)
+        {
+            reject(job, "Estimated memory of the job exceeds per-job limit", "ETOOLARGE");
+            return false;
+        }
+
+        // Always admit at least one job, no matter how large it is
+        if (m_options.maxInFlightBytes > 0 && m_inFlight > 0 && m_inFlightBytes + jobBytes > m_options.maxInFlightBytes)
+        {
+            reject(job, "Memory limit of queued jobs exceeded", "EQUEUEFULL");
+            return false;
+        }
+
+        initializeAsync();
+
+        if (m_threads.empty())
+            start();
+
+        // Keep event loop alive while there are jobs in flight
+        if (m_inFlight++ == 0)
+            uv_ref(reinterpret_cast<uv_handle_t*>(&m_async));
+
+        m_inFlightBytes += jobBytes;
+        job->markQueued(jobBytes, m_options.maxJobBytes);
+
+        {
+            std::lock_guard<std::mutex> guard(m_queueLock);
+            m_queue.push_back(job);
+        }
+
+        m_queueCondition.notify_one();
+        return true;
+    }
+
+    void ThreadPool::reject(Job * job, const std::string& errorMessage, const std::string& errorCode)
+    {
+        m_rejectedCount++;
+        job->Reject(errorMessage, errorCode);
+
+        initializeAsync();
+
+        // Callback runs on the next loop turn, so callers never see it re-entrantly
+        if (m_inFlight == 0 && m_rejected.empty())
+            uv_ref(reinterpret_cast<uv_handle_t*>(&m_async));
+
+        m_rejected.push_back(job);
+        uv_async_send(&m_async);
+    }
+
+    void ThreadPool::initializeAsync()
+    {
+        if (m_asyncInitialized)
+            return;
+
+        uv_async_init(uv_default_loop(), &m_async, &ThreadPool::OnJobsCompleted);
+        m_async.data = this;
+        uv_unref(reinterpret_cast<uv_handle_t*>(&m_async));
+        m_asyncInitialized = true;
+    }
+
+    void ThreadPool::configure(const ThreadPoolOptions& options)
+    {
+        // Threads are compared by effective count, so zero and the hardware count are the same setting
+        const bool restart = !m_threads.empty() && (
+               EffectiveThreads(options) != EffectiveThreads(m_options)
+            || options.stackSize != m_options.stackSize
+            || options.name != m_options.name);
+
+#if CLOUDCV_USE_PTHREADS
+        // Threads start lazily, so check the stack size now to report it to the caller of configure
+        {
+            pthread_attr_t attributes;
+            pthread_attr_init(&attributes);
+
+            SetStackSize(attributes, options.stackSize);
+
+            pthread_attr_destroy(&attributes);
+        }
+#endif
+
+        if (restart)
+        {
+            if (m_inFlight > 0)
+                throw std::runtime_error("Cannot reconfigure thread pool while jobs are running");
+
+            stop();
+        }
+
+        m_options = options;
+    }
+
+    ThreadPoolOptions ThreadPool::options() const
+    {
+        ThreadPoolOptions result = m_options;
+        result.threads = EffectiveThreads(m_options);
+        return result;
+    }
+
+    const ThreadPoolOptions& ThreadPool::configuration() const
+    {
+        return m_options;
+    }
+
+    size_t ThreadPool::inFlight() const
+    {
+        return m_inFlight;
+    }
+
+    void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& body)
+    {
+        struct State
+        {
+            std::function<void(size_t)> body;
+            size_t                      count;
+            std::atomic<size_t>         next;
+
+            //! Helpers charge allocations to the job that started the loop
+            MemoryAccount *             account;
+
+            std::mutex                  lock;
+            std::condition_variable     done;
+            size_t                      finished;
+        };
+
+        if (count == 0)
+            return;
+
+        // Helpers may start after the loop has returned, so state is shared with them
+        auto state = std::make_shared<State>();
+        state->body = body;
+        state->count = count;
+        state->next = 0;
+        state->finished = 0;
+        state->account = MemoryAccount::Current();
+
+        auto run = [state]()
+        {
+            ScopedMemoryAccount account(state->account);
+            size_t processed = 0;
+
+            for (size_t i = state->next++; i < state->count; i = state->next++)
+            {
+                state->body(i);
+                processed++;
+            }
+
+            if (processed > 0)
+            {
+                std::lock_guard<std::mutex> guard(state->lock);
+                state->finished += processed;
+
+                if (state->finished == state->count)
+                    state->done.notify_all();
+            }
+        };
+
+        const size_t helpers = std::min(count, m_workerCount.load()) - (m_workerCount > 0 ? 1 : 0);
+
+        if (helpers > 0)
+        {
+            {
+                std::lock_guard<std::mutex> guard(m_queueLock);
+                for (size_t i = 0; i < helpers; i++)
+                    m_helpers.push_back(run);
+            }
+
+            m_queueCondition.notify_all();
+        }
+
+        run();
+
+        std::unique_lock<std::mutex> lock(state->lock);
+        state->done.wait(lock, [&state]() { return state->finished == state->count; });
+    }
+
+    ThreadPoolStatistics ThreadPool::statistics()
+    {
+        ThreadPoolStatistics stats;
+
+        stats.threads          = options().threads;
+        stats.inFlight         = m_inFlight;
+        stats.inFlightBytes    = m_inFlightBytes;
+        stats.maxQueueDepth    = m_options.maxQueueDepth;
+        stats.maxInFlightBytes = m_options.maxInFlightBytes;
+        stats.completed        = m_completedCount;
+        stats.rejected         = m_rejectedCount;
+
+        {
+            std::lock_guard<std::mutex> guard(m_queueLock);
+            stats.queued        = m_queue.size();
+            stats.averageWaitMs = m_averageWaitMs;
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(m_completedLock);
+            stats.averageRunMs = m_averageRunMs;
+        }
+
+        stats.estimatedWaitMs = stats.queued * stats.averageRunMs / std::max<size_t>(1, stats.threads);
+        return stats;
+    }
+
+    void ThreadPool::start()
+    {
+        const ThreadPoolOptions effective = options();
+        LOG_TRACE_MESSAGE("Starting thread pool with " << effective.threads << " threads");
+
+        m_stopping = false;
+
+        for (size_t i = 0; i < effective.threads; i++)
+        {
+            std::string name = effective.name + "-" + std::to_string(i);
+            m_threads.emplace_back(new NativeThread(std::bind(&ThreadPool::workerLoop, this), effective.stackSize, name));
+        }
+
+        m_workerCount = m_threads.size();
+    }
+
+    void ThreadPool::stop()
+    {
+        {
+            std::lock_guard<std::mutex> guard(m_queueLock);
+            m_stopping = true;
+        }
+
+        m_queueCondition.notify_all();
+
+        for (auto& thread : m_threads)
+            thread->join();
+
+        m_threads.clear();
+        m_workerCount = 0;
+        m_helpers.clear();
+    }
+
+    void ThreadPool::workerLoop()
+    {
+        for (;;)
+        {
+            Job * job = nullptr;
+            std::function<void()> helper;
+
+            {
+                std::unique_lock<std::mutex> lock(m_queueLock);
+                m_queueCondition.wait(lock, [this]() { return m_stopping || !m_helpers.empty() || !m_queue.empty(); });
+
+                if (m_stopping)
+                    return;
+
+                // Helpers of running jobs go first, they unblock work that is already admitted
+                if (!m_helpers.empty())
+                {
+                    helper = std::move(m_helpers.front());
+                    m_helpers.pop_front();
+                }
+                else
+                {
+                    job = m_queue.front();
+                    m_queue.pop_front();
+
+                    m_averageWaitMs += SmoothingFactor * (job->queuedTimeMs() - m_averageWaitMs);
+                }
+            }
+
+            if (helper)
+            {
+                helper();
+                continue;
+            }
+
+            ScopedTimer timer;
+            job->Execute();
+            const double runMs = timer.executionTimeMs();
+
+            {
+                std::lock_guard<std::mutex> guard(m_completedLock);
+                m_completed.push_back(job);
+                m_averageRunMs += SmoothingFactor * (runMs - m_averageRunMs);
+            }
+
+            uv_async_send(&m_async);
+        }
+    }
+
+    void ThreadPool::completeJobs()
+    {
+        std::vector<Job*> completed, rejected;
+
+        {
+            std::lock_guard<std::mutex> guard(m_completedLock);
+            completed.swap(m_completed);
+        }
+
+        rejected.swap(m_rejected);
+
+        // Counters are updated first, so callbacks see their own job as completed
+        m_inFlight -= completed.size();
+        m_completedCount += completed.size();
+
+        for (Job * job : completed)
+            m_inFlightBytes -= job->admittedBytes();
+
+        for (Job * job : rejected)
+            completed.push_back(job);
+
+        for (Job * job : completed)
+        {
+            job->WorkComplete();
+            job->Destroy();
+        }
+
+        NativeMemory::Instance().reportExternalMemory();
+
+        if (m_inFlight == 0 && m_rejected.empty() && !completed.empty())
+            uv_unref(reinterpret_cast<uv_handle_t*>(&m_async));
+    }
+
+    NAUV_WORK_CB(ThreadPool::OnJobsCompleted)
+    {
+        static_cast<ThreadPool*>(async->data)->completeJobs();
+    }
+}
@@ -0,0 +1,231 @@
+/**********************************************************************************
+* CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+*                    This project lets you to quickly prototype a REST API
+*                    in a Node.js for a image processing service written in C++.
+*
+* Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+*
+* More information:
+*  - https://cloudcv.io
+*  - http://computer-vision-talks.com
+*
+**********************************************************************************/
+#pragma once
+
+#include <node.h>
+#include <v8.h>
+#include <nan.h>
+#include <nan-marshal.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace cloudcv
+{
+    class Job;
+
+    struct ThreadPoolOptions
+    {
+        ThreadPoolOptions();
+
+        //! Number of worker threads. Zero means number of hardware threads.
+        size_t      threads;
+
+        //! Stack size of worker threads in bytes. Zero means platform default.
+        size_t      stackSize;
+
+        //! Prefix of worker thread names, as seen in debuggers and profilers
+        std::string name;
+
+        //! Maximum number of jobs waiting for a worker thread. Zero means unlimited.
+        size_t      maxQueueDepth;
+
+        //! Maximum estimated memory of all jobs in flight, see Job::memoryEstimate. Zero means unlimited.
+        size_t      maxInFlightBytes;
+
+        /**
+         * @brief Maximum memory of a single job. Zero means unlimited. Jobs with larger 
+         *        estimate are rejected, jobs that allocate more matrix memory while 
+         *        running fail. Both get ETOOLARGE error code.
+         */
+        size_t      maxJobBytes;
+    };
+
+    /**
+     * @brief Snapshot of thread pool load.
+     */
+    struct ThreadPoolStatistics
+    {
+        size_t   threads;
+        size_t   queued;
+        size_t   inFlight;
+        size_t   inFlightBytes;
+        size_t   maxQueueDepth;
+        size_t   maxInFlightBytes;
+        uint64_t completed;
+        uint64_t rejected;
+
+        //! Moving average of time jobs spend in the queue
+        double   averageWaitMs;
+
+        //! Moving average of job execution time
+        double   averageRunMs;
+
+        //! Expected wait time of a job submitted now
+        double   estimatedWaitMs;
+    };
+
+    /**
+     * @brief   Native thread pool that runs jobs of the addon.
+     * @details Jobs are executed on threads owned by the addon, so CV workload 
+     *          does not compete with fs, DNS and zlib for the libuv threadpool. 
+     *          Completed jobs are handed back to the V8 thread via uv_async_t, 
+     *          where their callbacks are invoked. Threads are started lazily on 
+     *          the first job. 
+     *          The queue is bounded: jobs that exceed queue depth or in-flight 
+     *          memory limits are rejected immediately with EQUEUEFULL error code,
+     *          jobs larger than per-job memory limit with ETOOLARGE.
+     *          All public methods must be called from the V8 thread.
+     */
+    class ThreadPool
+    {
+    public:
+        static ThreadPool& Instance();
+
+        ~ThreadPool();
+
+        /**
+         * @brief  Schedules job for execution. Pool takes ownership of the job.
+         * @return False if job was rejected by admission control. Rejected job 
+         *         gets its callback invoked with error on the next loop turn.
+         */
+        bool enqueue(Job * job);
+
+        /**
+         * @brief Applies new options. Changing effective number of threads, stack size 
+         *        or name restarts running worker threads and cannot be done while there 
+         *        are jobs in flight. Queue limits can be changed at any time.
+         */
+        void configure(const ThreadPoolOptions& options);
+
+        ThreadPoolStatistics statistics();
+
+        //! Options in effect, with zero threads replaced by the number of hardware threads
+        ThreadPoolOptions options() const;
+
+        //! Options as configured, to be modified and passed back to configure()
+        const ThreadPoolOptions& configuration() const;
+
+        //! Number of jobs that were scheduled but not completed yet
+        size_t inFlight() const;
+
+        /**
+         * @brief   Calls body(i) for every i in [0, count) using idle worker threads.
+         * @details Safe to call from a job running on this pool: the calling thread 
+         *          processes items as well and helper tasks take priority over queued 
+         *          jobs, so the pool never waits on itself. Returns when all items are 
+         *          processed. The body must not throw.
+         */
+        void parallelFor(size_t count, const std::function<void(size_t)>& body);
+
+    private:
+        class NativeThread;
+
+        ThreadPool();
+
+        void reject(Job * job, const std::string& errorMessage, const std::string& errorCode);
+        void initializeAsync();
+        void start();
+        void stop();
+        void workerLoop();
+        void completeJobs();
+
+        //! Weight of the latest sample in moving averages
+        static const double SmoothingFactor;
+
+        static NAUV_WORK_CB(OnJobsCompleted);
+
+        ThreadPoolOptions m_options;
+
+        std::vector< std::unique_ptr<NativeThread> > m_threads;
+
+        std::mutex              m_queueLock;
+        std::condition_variable m_queueCondition;
+        std::deque<Job*>        m_queue;
+        std::deque< std::function<void()> > m_helpers;
+        bool                    m_stopping;
+        double                  m_averageWaitMs;
+
+        std::mutex              m_completedLock;
+        std::vector<Job*>       m_completed;
+        double                  m_averageRunMs;
+
+        std::atomic<size_t>     m_workerCount;
+
+        //! Rejected jobs waiting for their callbacks, V8 thread only
+        std::vector<Job*>       m_rejected;
+
+        uv_async_t              m_async;
+        bool                    m_asyncInitialized;
+        size_t                  m_inFlight;
+        size_t                  m_inFlightBytes;
+        uint64_t                m_completedCount;
+        uint64_t                m_rejectedCount;
+    };
+}
+
+namespace Nan
+{
+    namespace marshal
+    {
+        using namespace cloudcv;
+
+        template<>
+        struct Serializer<ThreadPoolOptions>
+        {
+            template<typename InputArchive>
+            static inline void load(InputArchive& ar, ThreadPoolOptions& val) = delete;
+
+            template<typename OutputArchive>
+            static inline void save(OutputArchive& ar, const ThreadPoolOptions& val)
+            {
+                ar & make_nvp("threads",   static_cast<double>(val.threads));
+                ar & make_nvp("stackSize", static_cast<double>(val.stackSize));
+                ar & make_nvp("name",      val.name);
+                ar & make_nvp("maxQueueDepth",    static_cast<double>(val.maxQueueDepth));
+                ar & make_nvp("maxInFlightBytes", static_cast<double>(val.maxInFlightBytes));
+                ar & make_nvp("maxJobBytes",      static_cast<double>(val.maxJobBytes));
+            }
+        };
+
+        template<>
+        struct Serializer<ThreadPoolStatistics>
+        {
+            template<typename InputArchive>
+            static inline void load(InputArchive& ar, ThreadPoolStatistics& val) = delete;
+
+            template<typename OutputArchive>
+            static inline void save(OutputArchive& ar, const ThreadPoolStatistics& val)
+            {
+                ar & make_nvp("threads",          static_cast<double>(val.threads));
+                ar & make_nvp("queued",           static_cast<double>(val.queued));
+                ar & make_nvp("inFlight",         static_cast<double>(val.inFlight));
+                ar & make_nvp("inFlightBytes",    static_cast<double>(val.inFlightBytes));
+                ar & make_nvp("maxQueueDepth",    static_cast<double>(val.maxQueueDepth));
+                ar & make_nvp("maxInFlightBytes", static_cast<double>(val.maxInFlightBytes));
+                ar & make_nvp("completed",        static_cast<double>(val.completed));
+                ar & make_nvp("rejected",         static_cast<double>(val.rejected));
+                ar & make_nvp("averageWaitMs",    val.averageWaitMs);
+                ar & make_nvp("averageRunMs",     val.averageRunMs);
+                ar & make_nvp("estimatedWaitMs",  val.estimatedWaitMs);
+            }
+        };
+    }
+}
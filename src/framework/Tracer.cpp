@@ -0,0 +1,271 @@
+/**********************************************************************************
+* CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+*                    This project lets you to quickly prototype a REST API
+*                    in a Node.js for a image processing service written in C++.
+*
+* Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+*
+* More information:
+*  - https://cloudcv.io
+*  - http://computer-vision-talks.com
+*
+**********************************************************************************/
+#include "framework/Tracer.hpp"
+
+#if TARGET_PLATFORM_WINDOWS
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+namespace cloudcv
+{
+    std::atomic<bool> Tracer::s_enabled(false);
+
+    /**
+     * @brief Ring of events written by one thread. Readers copy events without
+     *        stopping the writer and discard the ones that may have been overwritten.
+     */
+    class Tracer::ThreadBuffer
+    {
+    public:
+        explicit ThreadBuffer(uint32_t threadId)
+            : m_threadId(threadId)
+            , m_head(0)
+            , m_events(RingSize)
+        {
+        }
+
+        inline Event& next()
+        {
+            return m_events[m_head.load(std::memory_order_relaxed) % RingSize];
+        }
+
+        inline void commit()
+        {
+            m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        void copyTo(std::vector<Event>& events) const
+        {
+            const uint64_t head = m_head.load(std::memory_order_acquire);
+            const uint64_t first = head > RingSize ? head - RingSize : 0;
+
+            std::vector<Event> copy;
+            copy.reserve(static_cast<size_t>(head - first));
+
+            for (uint64_t i = first; i < head; i++)
+                copy.push_back(m_events[i % RingSize]);
+
+            // Events below this index may have been overwritten while we were copying,
+            // including the slot the writer may be filling right now
+            const uint64_t valid = m_head.load(std::memory_order_acquire) + 1;
+            const uint64_t firstValid = valid > RingSize ? valid - RingSize : 0;
+            const size_t skip = static_cast<size_t>(std::min<uint64_t>(firstValid > first ? firstValid - first : 0, copy.size()));
+
+            events.insert(events.end(), copy.begin() + skip, copy.end());
+        }
+
+        inline uint32_t threadId() const
+        {
+            return m_threadId;
+        }
+
+    private:
+        uint32_t              m_threadId;
+        std::atomic<uint64_t> m_head;
+        std::vector<Event>    m_events;
+    };
+
+    namespace
+    {
+        void AppendEscaped(std::ostringstream& out, const char * text)
+        {
+            for (const char * c = text; *c != 0; c++)
+            {
+                switch (*c)
+                {
+                case '"':  out << "\\\""; break;
+                case '\\': out << "\\\\"; break;
+                case '\n': out << "\\n"; break;
+                case '\r': out << "\\r"; break;
+                case '\t': out << "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(*c) < 0x20)
+                    {
+                        char escaped[8];
+                        std::snprintf(escaped, sizeof(escaped), "\\u%04x", *c);
+                        out << escaped;
+                    }
+                    else
+                    {
+                        out << *c;
+                    }
+                }
+            }
+        }
+    }
+
+    Tracer::Tracer()
+        : m_sessionStart(0)
+    {
+    }
+
+    Tracer& Tracer::Instance()
+    {
+        // Never destroyed: worker threads may record events during shutdown
+        static Tracer * instance = new Tracer();
+        return *instance;
+    }
+
+    uint64_t Tracer::Now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void Tracer::start()
+    {
+        m_sessionStart.store(Now(), std::memory_order_relaxed);
+        s_enabled.store(true, std::memory_order_release);
+    }
+
+    void Tracer::stop()
+    {
+        s_enabled.store(false, std::memory_order_release);
+    }
+
+    Tracer::ThreadBuffer& Tracer::threadBuffer()
+    {
+        // Returns the buffer to the tracer when the thread exits
+        struct Lease
+        {
+            std::shared_ptr<ThreadBuffer> buffer;
+
+            ~Lease()
+            {
+                if (buffer)
+                    Tracer::Instance().releaseThreadBuffer(buffer);
+            }
+        };
+
+        // Plain pointer keeps the hot path free of thread_local initialization checks
+        static thread_local ThreadBuffer * buffer = nullptr;
+
+        if (buffer == nullptr)
+        {
+            static thread_local Lease lease;
+            std::lock_guard<std::mutex> guard(m_buffersLock);
+
+            // Buffers outlive their threads so the events can still be exported; the next
+            // thread appends to the buffer of an exited one under the same thread id
+            if (!m_idleBuffers.empty())
+            {
+                lease.buffer = m_idleBuffers.back();
+                m_idleBuffers.pop_back();
+            }
+            else
+            {
+                m_buffers.push_back(std::make_shared<ThreadBuffer>(static_cast<uint32_t>(m_buffers.size() + 1)));
+                lease.buffer = m_buffers.back();
+            }
+
+            buffer = lease.buffer.get();
+        }
+
+        return *buffer;
+    }
+
+    void Tracer::releaseThreadBuffer(const std::shared_ptr<ThreadBuffer>& buffer)
+    {
+        std::lock_guard<std::mutex> guard(m_buffersLock);
+        m_idleBuffers.push_back(buffer);
+    }
+
+    void Tracer::complete(const char * name, uint64_t startTimestamp)
+    {
+        ThreadBuffer& buffer = threadBuffer();
+        Event& event = buffer.next();
+
+        event.name       = name;
+        event.timestamp  = startTimestamp;
+        event.duration   = Now() - startTimestamp;
+        event.phase      = 'X';
+        event.message[0] = 0;
+
+        buffer.commit();
+    }
+
+    void Tracer::instant(const std::string& message)
+    {
+        ThreadBuffer& buffer = threadBuffer();
+        Event& event = buffer.next();
+
+        const size_t length = std::min(message.size(), MessageLength - 1);
+
+        event.name      = nullptr;
+        event.timestamp = Now();
+        event.duration  = 0;
+        event.phase     = 'i';
+        std::memcpy(event.message, message.data(), length);
+        event.message[length] = 0;
+
+        buffer.commit();
+    }
+
+    std::string Tracer::dump() const
+    {
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+        {
+            std::lock_guard<std::mutex> guard(m_buffersLock);
+            buffers = m_buffers;
+        }
+
+        const uint64_t sessionStart = m_sessionStart.load(std::memory_order_relaxed);
+        const int processId = static_cast<int>(getpid());
+
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(3);
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+        bool first = true;
+        std::vector<Event> events;
+
+        for (const auto& buffer : buffers)
+        {
+            events.clear();
+            buffer->copyTo(events);
+
+            for (const auto& event : events)
+            {
+                if (event.timestamp < sessionStart)
+                    continue;
+
+                out << (first ? "" : ",") << "{\"name\":\"";
+                AppendEscaped(out, event.name != nullptr ? event.name : event.message);
+                out << "\",\"cat\":\"cloudcv\",\"ph\":\"" << event.phase << "\"";
+
+                // Chrome expects microseconds relative to any common origin
+                out << ",\"ts\":" << (event.timestamp - sessionStart) / 1000.0;
+
+                if (event.phase == 'X')
+                    out << ",\"dur\":" << event.duration / 1000.0;
+                else
+                    out << ",\"s\":\"t\"";
+
+                out << ",\"pid\":" << processId << ",\"tid\":" << buffer->threadId() << "}";
+                first = false;
+            }
+        }
+
+        out << "]}";
+        return out.str();
+    }
+}
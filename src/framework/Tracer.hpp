@@ -0,0 +1,118 @@
+/**********************************************************************************
+* CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+*                    This project lets you to quickly prototype a REST API
+*                    in a Node.js for a image processing service written in C++.
+*
+* Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+*
+* More information:
+*  - https://cloudcv.io
+*  - http://computer-vision-talks.com
+*
+**********************************************************************************/
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace cloudcv
+{
+    /**
+     * @brief   Runtime-toggleable tracer writing fixed-size events into per-thread ring buffers.
+     * @details Every thread that records events gets its own ring, so recording takes no 
+     *          locks; the oldest events are overwritten when a ring is full. When tracing 
+     *          is off a trace point costs one relaxed atomic load. Rings of exited threads
+     *          are reused by new ones, so there are never more rings than threads that 
+     *          recorded at the same time. Events are exported as Chrome trace_event JSON 
+     *          (chrome://tracing, Perfetto).
+     */
+    class Tracer
+    {
+    public:
+        //! Events kept per thread
+        static const size_t RingSize = 8192;
+
+        //! Longer messages are truncated
+        static const size_t MessageLength = 48;
+
+        struct Event
+        {
+            //! Function name for scope events; must be a string with static storage
+            const char * name;
+
+            //! Nanoseconds of the monotonic clock
+            uint64_t     timestamp;
+            uint64_t     duration;
+
+            //! Chrome trace phase: 'X' for scopes, 'i' for messages
+            char         phase;
+            char         message[MessageLength];
+        };
+
+        static Tracer& Instance();
+
+        static inline bool Enabled()
+        {
+            return s_enabled.load(std::memory_order_relaxed);
+        }
+
+        static uint64_t Now();
+
+        //! Starts a new session; events recorded before it are not exported
+        void start();
+
+        void stop();
+
+        //! Events of the current or last session in Chrome trace_event JSON format
+        std::string dump() const;
+
+        void complete(const char * name, uint64_t startTimestamp);
+
+        void instant(const std::string& message);
+
+    private:
+        class ThreadBuffer;
+
+        Tracer();
+
+        ThreadBuffer& threadBuffer();
+
+        //! Called when the owning thread exits; the buffer is handed to the next new thread
+        void releaseThreadBuffer(const std::shared_ptr<ThreadBuffer>& buffer);
+
+        static std::atomic<bool> s_enabled;
+
+        std::atomic<uint64_t>                      m_sessionStart;
+        mutable std::mutex                         m_buffersLock;
+        std::vector<std::shared_ptr<ThreadBuffer>> m_buffers;
+        std::vector<std::shared_ptr<ThreadBuffer>> m_idleBuffers;
+    };
+
+    //! Records the enclosing scope as a complete event if tracing is on when it is entered
+    class TraceScope
+    {
+    public:
+        explicit inline TraceScope(const char * name)
+            : m_name(Tracer::Enabled() ? name : nullptr)
+            , m_start(m_name != nullptr ? Tracer::Now() : 0)
+        {
+        }
+
+        inline ~TraceScope()
+        {
+            if (m_name != nullptr)
+                Tracer::Instance().complete(m_name, m_start);
+        }
+
+    private:
+        TraceScope(const TraceScope&) = delete;
+        TraceScope& operator=(const TraceScope&) = delete;
+
+        const char * m_name;
+        uint64_t     m_start;
+    };
+}
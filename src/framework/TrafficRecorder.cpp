@@ -0,0 +1,270 @@
+/**********************************************************************************
+* CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+*                    This project lets you to quickly prototype a REST API
+*                    in a Node.js for a image processing service written in C++.
+*
+* Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+*
+* More information:
+*  - https://cloudcv.io
+*  - http://computer-vision-talks.com
+*
+**********************************************************************************/
+#include "framework/TrafficRecorder.hpp"
+#include "framework/AlgorithmInfo.hpp"
+#include "framework/Argument.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+namespace cloudcv
+{
+    std::atomic<bool> TrafficRecorder::s_enabled(false);
+
+    namespace
+    {
+        const char     Magic[] = "CCVTRAF1";
+        const uint8_t  ImageRecord = 1;
+        const uint8_t  RequestRecord = 2;
+
+        // The log is little-endian, which is the byte order of all platforms we build for
+        template <typename T>
+        void Put(std::string& out, T value)
+        {
+            out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        void PutString(std::string& out, const std::string& value)
+        {
+            Put<uint32_t>(out, static_cast<uint32_t>(value.size()));
+            out.append(value);
+        }
+
+        uint64_t NowNs()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+    }
+
+    TrafficRecordWriter::TrafficRecordWriter()
+        : m_count(0)
+    {
+    }
+
+    void TrafficRecordWriter::header(const std::string& name, ValueKind kind)
+    {
+        PutString(m_values, name);
+        Put<uint8_t>(m_values, static_cast<uint8_t>(kind));
+        m_count++;
+    }
+
+    void TrafficRecordWriter::number(const std::string& name, double value)
+    {
+        header(name, NumberValue);
+        Put<double>(m_values, value);
+    }
+
+    void TrafficRecordWriter::string(const std::string& name, const std::string& value)
+    {
+        header(name, StringValue);
+        PutString(m_values, value);
+    }
+
+    bool TrafficRecordWriter::image(const std::string& name, const ImageView& value)
+    {
+        EncodedImage encoded;
+        if (value.encodedData(encoded.data, encoded.length, encoded.hash))
+        {
+            header(name, ImageValue);
+            Put<uint64_t>(m_values, encoded.hash);
+            Put<uint32_t>(m_values, static_cast<uint32_t>(encoded.length));
+            m_images.push_back(encoded);
+            return true;
+        }
+
+        std::string path;
+        if (value.sourcePath(path))
+        {
+            header(name, ImageFileValue);
+            PutString(m_values, path);
+            return true;
+        }
+
+        return false;
+    }
+
+    TrafficRecorder::Options::Options()
+        : imageSampleRate(0.1)
+        , maxBytes(1024 * 1024 * 1024)
+    {
+    }
+
+    TrafficRecorder::TrafficRecorder()
+        : m_startTime(0)
+        , m_loggedBytes(0)
+        , m_stopping(false)
+        , m_requests(0)
+        , m_imagesStored(0)
+        , m_bytesWritten(0)
+        , m_dropped(0)
+    {
+    }
+
+    TrafficRecorder& TrafficRecorder::Instance()
+    {
+        // Never destroyed: the writer thread may still run at exit
+        static TrafficRecorder * instance = new TrafficRecorder();
+        return *instance;
+    }
+
+    void TrafficRecorder::start(const Options& options)
+    {
+        stop();
+
+        m_file.open(options.path.c_str(), std::ios::binary | std::ios::trunc);
+        if (!m_file)
+            throw std::runtime_error("Cannot create traffic log " + options.path);
+
+        m_file.write(Magic, sizeof(Magic) - 1);
+
+        m_options     = options;
+        m_startTime   = NowNs();
+        m_loggedBytes = sizeof(Magic) - 1;
+        m_stopping    = false;
+        m_storedImages.clear();
+
+        m_requests     = 0;
+        m_imagesStored = 0;
+        m_bytesWritten = m_loggedBytes;
+        m_dropped      = 0;
+
+        m_writer = std::thread(&TrafficRecorder::writerLoop, this);
+        s_enabled.store(true, std::memory_order_release);
+    }
+
+    void TrafficRecorder::stop()
+    {
+        s_enabled.store(false, std::memory_order_release);
+
+        if (!m_writer.joinable())
+            return;
+
+        {
+            std::lock_guard<std::mutex> guard(m_lock);
+            m_stopping = true;
+        }
+
+        m_wake.notify_one();
+        m_writer.join();
+        m_file.close();
+    }
+
+    void TrafficRecorder::record(const AlgorithmInfo& info, const ArgumentBindings& inArgs)
+    {
+        TrafficRecordWriter writer;
+
+        for (const auto& arg : info.inputSlots())
+        {
+            const ParameterBindingPtr& binding = inArgs[arg->slot()];
+            if (binding)
+                binding->record(arg->name(), writer);
+        }
+
+        std::string entry;
+        std::vector<uint64_t> stored;
+
+        // Images go before the first request that references them
+        for (const auto& image : writer.images())
+        {
+            if (m_storedImages.count(image.hash) > 0 || std::find(stored.begin(), stored.end(), image.hash) != stored.end())
+                continue;
+
+            // Decision by hash, so every occurrence of an image gets the same one
+            if (static_cast<double>(image.hash % 1000000) >= m_options.imageSampleRate * 1000000)
+                continue;
+
+            stored.push_back(image.hash);
+
+            Put<uint8_t>(entry, ImageRecord);
+            Put<uint64_t>(entry, image.hash);
+            Put<uint32_t>(entry, static_cast<uint32_t>(image.length));
+            entry.append(image.data, image.length);
+        }
+
+        Put<uint8_t>(entry, RequestRecord);
+        Put<double>(entry, (NowNs() - m_startTime) * 1e-6);
+        PutString(entry, info.name());
+        Put<uint8_t>(entry, static_cast<uint8_t>(writer.count()));
+        entry.append(writer.values());
+
+        if (m_loggedBytes + entry.size() > m_options.maxBytes || !append(entry))
+        {
+            m_dropped++;
+            return;
+        }
+
+        m_storedImages.insert(stored.begin(), stored.end());
+        m_imagesStored += stored.size();
+        m_loggedBytes += entry.size();
+        m_requests++;
+    }
+
+    bool TrafficRecorder::append(const std::string& entry)
+    {
+        {
+            std::lock_guard<std::mutex> guard(m_lock);
+
+            if (m_pending.size() + entry.size() > MaxPendingBytes)
+                return false;
+
+            m_pending.append(entry);
+        }
+
+        m_wake.notify_one();
+        return true;
+    }
+
+    void TrafficRecorder::writerLoop()
+    {
+        std::string chunk;
+
+        for (;;)
+        {
+            bool stopping;
+
+            {
+                std::unique_lock<std::mutex> lock(m_lock);
+                m_wake.wait_for(lock, std::chrono::milliseconds(200), [this] { return m_stopping || !m_pending.empty(); });
+
+                chunk.swap(m_pending);
+                stopping = m_stopping;
+            }
+
+            if (!chunk.empty())
+            {
+                m_file.write(chunk.data(), chunk.size());
+                m_file.flush();
+                m_bytesWritten += chunk.size();
+                chunk.clear();
+            }
+
+            if (stopping)
+                return;
+        }
+    }
+
+    TrafficRecorder::Statistics TrafficRecorder::statistics() const
+    {
+        Statistics stats;
+
+        stats.recording    = Enabled();
+        stats.requests     = m_requests;
+        stats.imagesStored = m_imagesStored;
+        stats.bytesWritten = m_bytesWritten;
+        stats.dropped      = m_dropped;
+
+        return stats;
+    }
+}
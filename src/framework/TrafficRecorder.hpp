@@ -0,0 +1,198 @@
+/**********************************************************************************
+* CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+*                    This project lets you to quickly prototype a REST API
+*                    in a Node.js for a image processing service written in C++.
+*
+* Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+*
+* More information:
+*  - https://cloudcv.io
+*  - http://computer-vision-talks.com
+*
+**********************************************************************************/
+#pragma once
+
+#include "framework/ImageView.hpp"
+
+#include <nan.h>
+#include <nan-marshal.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace cloudcv
+{
+    class AlgorithmInfo;
+    class ArgumentBindings;
+
+    /**
+     * @brief   Serializes bound arguments of one request into a traffic log record.
+     * @details Values are appended in the log encoding: little-endian numbers and 
+     *          strings prefixed with 32-bit length. Encoded images are referenced 
+     *          by content hash; the recorder decides whether their bytes are stored.
+     */
+    class TrafficRecordWriter
+    {
+    public:
+        enum ValueKind
+        {
+            NumberValue    = 1,     //!< f64
+            StringValue    = 2,     //!< str
+            ImageValue     = 3,     //!< u64 content hash, u32 encoded length
+            ImageFileValue = 4      //!< str path
+        };
+
+        struct EncodedImage
+        {
+            uint64_t     hash;
+            const char * data;
+            size_t       length;
+        };
+
+        TrafficRecordWriter();
+
+        void number(const std::string& name, double value);
+
+        void string(const std::string& name, const std::string& value);
+
+        //! Returns false for images that were created from matrices
+        bool image(const std::string& name, const ImageView& value);
+
+        //! Number of values written so far
+        size_t count() const { return m_count; }
+
+        const std::string& values() const { return m_values; }
+
+        const std::vector<EncodedImage>& images() const { return m_images; }
+
+    private:
+        void header(const std::string& name, ValueKind kind);
+
+        std::string               m_values;
+        size_t                    m_count;
+        std::vector<EncodedImage> m_images;
+    };
+
+    /**
+     * @brief   Records requests of processFunction into a compact binary log.
+     * @details Each request is logged with its time, algorithm name and bound values 
+     *          of input arguments, defaults included. Encoded images are logged by 
+     *          content hash; bytes of a sampled subset of distinct images are stored 
+     *          once per log, the decision is made by hash, so it is the same for 
+     *          every occurrence of an image. Records are built on the V8 thread and 
+     *          written to disk by a background thread. bench/replay.js reads the log.
+     *
+     *          Layout: "CCVTRAF1" followed by records starting with type byte.
+     *          Image record (1):   u64 hash, u32 length, bytes
+     *          Request record (2): f64 ms since start, str algorithm, u8 count, 
+     *                              then count x (str name, u8 kind, value)
+     */
+    class TrafficRecorder
+    {
+    public:
+        struct Options
+        {
+            Options();
+
+            std::string path;
+
+            //! Fraction of distinct images whose bytes are stored
+            double      imageSampleRate;
+
+            //! Recording stops adding records when the log reaches this size
+            size_t      maxBytes;
+        };
+
+        struct Statistics
+        {
+            bool     recording;
+            uint64_t requests;
+            uint64_t imagesStored;
+            uint64_t bytesWritten;
+
+            //! Requests not logged because the log was full or the disk too slow
+            uint64_t dropped;
+        };
+
+        static TrafficRecorder& Instance();
+
+        //! Cheap check for the processFunction path
+        static inline bool Enabled()
+        {
+            return s_enabled.load(std::memory_order_relaxed);
+        }
+
+        //! Opens new log, stopping the current one. Throws std::runtime_error if the file cannot be created.
+        void start(const Options& options);
+
+        //! Writes pending records and closes the log
+        void stop();
+
+        //! Logs a request. V8 thread only.
+        void record(const AlgorithmInfo& info, const ArgumentBindings& inArgs);
+
+        Statistics statistics() const;
+
+    private:
+        TrafficRecorder();
+
+        //! Hands record over to the writer. Returns false if too much is pending already.
+        bool append(const std::string& entry);
+
+        void writerLoop();
+
+        static std::atomic<bool> s_enabled;
+
+        //! Records not yet written that are dropped above this size
+        static const size_t MaxPendingBytes = 64 * 1024 * 1024;
+
+        Options                      m_options;
+        uint64_t                     m_startTime;
+        size_t                       m_loggedBytes;
+        std::unordered_set<uint64_t> m_storedImages;
+
+        mutable std::mutex           m_lock;
+        std::condition_variable      m_wake;
+        std::string                  m_pending;
+        bool                         m_stopping;
+        std::ofstream                m_file;
+        std::thread                  m_writer;
+
+        std::atomic<uint64_t>        m_requests;
+        std::atomic<uint64_t>        m_imagesStored;
+        std::atomic<uint64_t>        m_bytesWritten;
+        std::atomic<uint64_t>        m_dropped;
+    };
+}
+
+namespace Nan
+{
+    namespace marshal
+    {
+        using namespace cloudcv;
+
+        template<>
+        struct Serializer<TrafficRecorder::Statistics>
+        {
+            template<typename InputArchive>
+            static inline void load(InputArchive& ar, TrafficRecorder::Statistics& val) = delete;
+
+            template<typename OutputArchive>
+            static inline void save(OutputArchive& ar, const TrafficRecorder::Statistics& val)
+            {
+                ar & make_nvp("recording",    val.recording);
+                ar & make_nvp("requests",     static_cast<double>(val.requests));
+                ar & make_nvp("imagesStored", static_cast<double>(val.imagesStored));
+                ar & make_nvp("bytesWritten", static_cast<double>(val.bytesWritten));
+                ar & make_nvp("dropped",      static_cast<double>(val.dropped));
+            }
+        };
+    }
+}
@@ -6,6 +6,7 @@
 
 #include "framework/Logger.hpp"
 #include "framework/ImageView.hpp"
+#include "framework/marshal/typedarray.hpp"
 
 namespace Nan
 {
@@ -151,8 +152,7 @@ namespace Nan
             template<typename OutputArchive>
             static inline void save(OutputArchive& ar, const cv::Mat& val)
             {
-                // TODO: Implement
-                //ar = cloudcv::ImageView::ViewForImage(val);
+                ar = CreateImageObject(val);
             }
         };
 
@@ -168,32 +168,47 @@ namespace Nan
             template<typename OutputArchive>
             static inline void save(OutputArchive& ar, const ImageView& val)
             {
-                const cv::Mat& m = val.getImage();
-
-                ar & make_nvp("rows", m.rows);
-                ar & make_nvp("cols", m.cols);
-                ar & make_nvp("channels", m.channels());
-                ar & make_nvp("type", m.type());
-
-                switch (m.type())
-                {
-                case CV_32F:
-                {
-                               auto start = m.ptr<float>(0);
-                               auto end = start + m.total();
-                               ar & make_nvp("data", std::vector<float>(start, end));
-                               break;
-                }
-                case CV_8U:
-                default:
-                {
-                           auto start = m.ptr<uint8_t>(0);
-                           auto end = start + m.elemSize() * m.total();
-                           ar & make_nvp("data", std::vector<uint8_t>(start, end));
-                           break;
-                }
-                }
+                ar = CreateImageObject(val.getImage());
             }
         };
     }
+}
+
+namespace cloudcv
+{
+    template <typename T>
+    struct PackedSerializer < std::vector< cv::Point_<T> > >
+    {
+        static inline v8::Local<v8::Value> save(const std::vector< cv::Point_<T> >& val)
+        {
+            return CreatePackedArray(reinterpret_cast<const T*>(val.data()), val.size(), 2);
+        }
+    };
+
+    template <typename T>
+    struct PackedSerializer < std::vector< cv::Point3_<T> > >
+    {
+        static inline v8::Local<v8::Value> save(const std::vector< cv::Point3_<T> >& val)
+        {
+            return CreatePackedArray(reinterpret_cast<const T*>(val.data()), val.size(), 3);
+        }
+    };
+
+    template <typename T>
+    struct PackedSerializer < std::vector< cv::Rect_<T> > >
+    {
+        static inline v8::Local<v8::Value> save(const std::vector< cv::Rect_<T> >& val)
+        {
+            return CreatePackedArray(reinterpret_cast<const T*>(val.data()), val.size(), 4);
+        }
+    };
+
+    template <typename T, int cn>
+    struct PackedSerializer < std::vector< cv::Vec<T, cn> > >
+    {
+        static inline v8::Local<v8::Value> save(const std::vector< cv::Vec<T, cn> >& val)
+        {
+            return CreatePackedArray(reinterpret_cast<const T*>(val.data()), val.size(), cn);
+        }
+    };
 }
\ No newline at end of file
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <nan.h>
+#include <nan-marshal.h>
+#include <opencv2/opencv.hpp>
+
+namespace cloudcv
+{
+    namespace detail
+    {
+        inline void ReleaseMatCallback(char * /*data*/, void * hint)
+        {
+            delete static_cast<cv::Mat*>(hint);
+        }
+
+        template <typename ArrayType>
+        inline v8::Local<v8::Value> CreateArrayView(v8::Local<v8::Object> buffer, size_t count)
+        {
+#if NODE_MODULE_VERSION >= NODE_4_0_MODULE_VERSION
+            v8::Local<v8::Uint8Array> bytes = buffer.As<v8::Uint8Array>();
+            return ArrayType::New(bytes->Buffer(), bytes->ByteOffset(), count);
+#else
+            // Buffers are not typed arrays in this Node.js version, so copy the data
+            const size_t length = node::Buffer::Length(buffer);
+            v8::Local<v8::ArrayBuffer> arrayBuffer = v8::ArrayBuffer::New(v8::Isolate::GetCurrent(), length);
+            memcpy(arrayBuffer->GetContents().Data(), node::Buffer::Data(buffer), length);
+            return ArrayType::New(arrayBuffer, 0, count);
+#endif
+        }
+    }
+
+    /**
+     * @brief Maps element type to the typed array class that stores it.
+     */
+    template <typename T> struct TypedArrayOf;
+
+    template <> struct TypedArrayOf<uint8_t>  { typedef v8::Uint8Array   type; };
+    template <> struct TypedArrayOf<int8_t>   { typedef v8::Int8Array    type; };
+    template <> struct TypedArrayOf<uint16_t> { typedef v8::Uint16Array  type; };
+    template <> struct TypedArrayOf<int16_t>  { typedef v8::Int16Array   type; };
+    template <> struct TypedArrayOf<int32_t>  { typedef v8::Int32Array   type; };
+    template <> struct TypedArrayOf<float>    { typedef v8::Float32Array type; };
+    template <> struct TypedArrayOf<double>   { typedef v8::Float64Array type; };
+
+    /**
+     * @brief   Creates packed representation of array of fixed-size records.
+     * @details Result is an object { shape: [count, components], data: TypedArray } 
+     *          where data holds interleaved components of all records. Data is copied
+     *          once into a single buffer instead of allocating JS object per record.
+     */
+    template <typename T>
+    inline v8::Local<v8::Value> CreatePackedArray(const T * data, size_t count, size_t components)
+    {
+        Nan::EscapableHandleScope scope;
+
+        const size_t length = count * components;
+
+        v8::Local<v8::Object> buffer = length > 0
+            ? Nan::CopyBuffer(reinterpret_cast<const char*>(data), length * sizeof(T)).ToLocalChecked()
+            : Nan::NewBuffer(0).ToLocalChecked();
+
+        v8::Local<v8::Array> shape = Nan::New<v8::Array>(2);
+        Nan::Set(shape, 0, Nan::New<v8::Number>(static_cast<double>(count)));
+        Nan::Set(shape, 1, Nan::New<v8::Number>(static_cast<double>(components)));
+
+        v8::Local<v8::Object> result = Nan::New<v8::Object>();
+        Nan::Set(result, Nan::New("shape").ToLocalChecked(), shape);
+        Nan::Set(result, Nan::New("data").ToLocalChecked(), detail::CreateArrayView<typename TypedArrayOf<T>::type>(buffer, length));
+
+        return scope.Escape(result);
+    }
+
+    /**
+     * @brief   Marshals value in packed form when it is supported for the value type.
+     * @details Primary template falls back to regular marshalling. Specializations
+     *          for vectors of points, rectangles and vectors live next to their 
+     *          serializers in marshal/opencv.hpp.
+     */
+    template <typename T>
+    struct PackedSerializer
+    {
+        static inline v8::Local<v8::Value> save(const T& val)
+        {
+            return Nan::Marshal(val);
+        }
+    };
+
+    /**
+     * @brief   Creates typed array that matches depth of the matrix on top of its data.
+     * @details No pixel data is copied for continuous matrices: the returned array 
+     *          references memory of the matrix, and the matrix is kept alive until
+     *          the array is garbage-collected. CV_8U data is returned as Buffer, 
+     *          other depths as Int8Array, Uint16Array, Int16Array, Int32Array, 
+     *          Float32Array or Float64Array with interleaved channels.
+     */
+    inline v8::Local<v8::Value> CreateTypedArray(const cv::Mat& image)
+    {
+        Nan::EscapableHandleScope scope;
+
+        cv::Mat * holder = new cv::Mat(image.isContinuous() ? image : image.clone());
+        const size_t bytes = holder->total() * holder->elemSize();
+        const size_t count = holder->total() * holder->channels();
+
+        v8::Local<v8::Object> buffer;
+        if (bytes > 0)
+        {
+            buffer = Nan::NewBuffer(reinterpret_cast<char*>(holder->data), bytes, detail::ReleaseMatCallback, holder).ToLocalChecked();
+        }
+        else
+        {
+            delete holder;
+            buffer = Nan::NewBuffer(0).ToLocalChecked();
+        }
+
+        switch (image.depth())
+        {
+        case CV_8S:  return scope.Escape(detail::CreateArrayView<v8::Int8Array>(buffer, count));
+        case CV_16U: return scope.Escape(detail::CreateArrayView<v8::Uint16Array>(buffer, count));
+        case CV_16S: return scope.Escape(detail::CreateArrayView<v8::Int16Array>(buffer, count));
+        case CV_32S: return scope.Escape(detail::CreateArrayView<v8::Int32Array>(buffer, count));
+        case CV_32F: return scope.Escape(detail::CreateArrayView<v8::Float32Array>(buffer, count));
+        case CV_64F: return scope.Escape(detail::CreateArrayView<v8::Float64Array>(buffer, count));
+        case CV_8U:
+        default:
+            return scope.Escape(buffer);
+        }
+    }
+
+    /**
+     * @brief Creates JS object describing the image: its shape, type and pixel data as typed array.
+     */
+    inline v8::Local<v8::Object> CreateImageObject(const cv::Mat& image)
+    {
+        Nan::EscapableHandleScope scope;
+
+        v8::Local<v8::Object> result = Nan::New<v8::Object>();
+        Nan::Set(result, Nan::New("rows").ToLocalChecked(),     Nan::New(image.rows));
+        Nan::Set(result, Nan::New("cols").ToLocalChecked(),     Nan::New(image.cols));
+        Nan::Set(result, Nan::New("channels").ToLocalChecked(), Nan::New(image.channels()));
+        Nan::Set(result, Nan::New("type").ToLocalChecked(),     Nan::New(image.type()));
+        Nan::Set(result, Nan::New("data").ToLocalChecked(),     CreateTypedArray(image));
+
+        return scope.Escape(result);
+    }
+}
@@ -28,36 +28,41 @@ namespace cloudcv
         struct image
         {
             static const char * name() { return "image"; };
+            enum { slot = 0 };
             typedef ImageView type;
         };
 
         struct rho
         {
             static const char * name() { return "rho"; };
+            enum { slot = 1 };
             typedef float type;
         };
 
         struct theta
         {
             static const char * name() { return "theta"; };
+            enum { slot = 2 };
             typedef float type;
         };
 
         struct threshold
         {
             static const char * name() { return "threshold"; };
+            enum { slot = 3 };
             typedef int type;
         };
 
         struct lines
         {
             static const char * name() { return "lines"; };
+            enum { slot = 0 };
             typedef std::vector<cv::Point2f> type;
         };
 
         void process(
-            const std::map<std::string, ParameterBindingPtr>& inArgs,
-            const std::map<std::string, ParameterBindingPtr>& outArgs
+            const ArgumentBindings& inArgs,
+            const ArgumentBindings& outArgs
             ) override
         {
             TRACE_FUNCTION;
@@ -65,11 +70,15 @@ namespace cloudcv
             const float _rho = getInput<rho>(inArgs);
             const float _theta = getInput<theta>(inArgs);
             const int _threshold = getInput<threshold>(inArgs);
+            // Image is decoded as grayscale unless another consumer needed colour;
+            // the conversion is then shared with every other grayscale consumer.
             cv::Mat inputImage = source.getImage(cv::IMREAD_GRAYSCALE);
+            throwIfCancelled();
 
             std::vector<cv::Point2f> &_lines = getOutput<lines>(outArgs);
 
             cv::HoughLines(inputImage, _lines, _rho, _theta, _threshold);
+            throwIfCancelled();
             LOG_TRACE_MESSAGE("Detected " << _lines.size() << " lines");
         }
     };
@@ -79,7 +88,7 @@ namespace cloudcv
     HoughLinesAlgorithmInfo::HoughLinesAlgorithmInfo()
         : AlgorithmInfo("houghLines",
         {
-            { inputArgument<HoughLinesAlgorithm::image>() },
+            { inputArgument<HoughLinesAlgorithm::image>(DecodeHints(cv::IMREAD_GRAYSCALE)) },
             { inputArgument<HoughLinesAlgorithm::rho>(1, 2, 100) },
             { inputArgument<HoughLinesAlgorithm::theta>(1, 2, 100) },
             { inputArgument<HoughLinesAlgorithm::threshold>(1, 2, 255) }
@@ -24,26 +24,31 @@ namespace cloudcv
         struct image
         {
             static const char * name() { return "image"; };
+            enum { slot = 0 };
             typedef ImageView type;
         };
 
         struct integralImage
         {
             static const char * name() { return "integralImage"; };
+            enum { slot = 0 };
             typedef ImageView type;
         };
         
 
         void process(
-            const std::map<std::string, ParameterBindingPtr>& inArgs,
-            const std::map<std::string, ParameterBindingPtr>& outArgs
+            const ArgumentBindings& inArgs,
+            const ArgumentBindings& outArgs
             ) override
         {
             TRACE_FUNCTION;
             ImageView _image = getInput<image>(inArgs);
             ImageView &_integralImage = getOutput<integralImage>(outArgs);
 
-            cv::integral(_image.getImage(cv::IMREAD_GRAYSCALE), _integralImage.getImage());
+            cv::Mat grayscale = _image.getImage(cv::IMREAD_GRAYSCALE);
+            throwIfCancelled();
+
+            cv::integral(grayscale, _integralImage.getImage());
         }
     };
 
@@ -52,7 +57,7 @@ namespace cloudcv
     IntegralImageAlgorithmInfo::IntegralImageAlgorithmInfo()
         : AlgorithmInfo("integralImage",
         {
-            { inputArgument<IntegralImageAlgorithm::image>() }
+            { inputArgument<IntegralImageAlgorithm::image>(DecodeHints(cv::IMREAD_GRAYSCALE)) }
     },
     {
         { outputArgument<IntegralImageAlgorithm::integralImage>() }
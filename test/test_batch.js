@@ -0,0 +1,59 @@
+/**********************************************************************************
+ * CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+ *                    This project lets you to quickly prototype a REST API
+ *                    in a Node.js for a image processing service written in C++. 
+ * 
+ * Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+ * 
+ * More information:
+ *  - https://cloudcv.io
+ *  - http://computer-vision-talks.com
+ * 
+ **********************************************************************************/
+
+var assert = require("assert")
+var fs     = require('fs');
+var inspect = require('util').inspect;
+
+var cloudcv = require("../cloudcv.js");
+
+describe('cv', function() {
+
+    describe('processBatch', function() {
+
+        it('process', function(done) {
+            var imageData = fs.readFileSync("test/data/opencv-logo.jpg");
+            var items = [];
+
+            for (var i = 0; i < 16; i++) {
+                items.push({ "image": imageData });
+            }
+
+            cloudcv.processBatch('houghLines', items, function(error, results) { 
+                assert.equal(error, null);
+                assert.equal(results.length, items.length);
+
+                results.forEach(function(item) {
+                    assert.equal(item.error, null);
+                    assert.notEqual(item.result.lines, null);
+                });
+                done();
+            });
+        });
+
+        it('reports errors per item', function(done) {
+            var imageData = fs.readFileSync("test/data/opencv-logo.jpg");
+            var items = [ { "image": imageData }, { "image": "test/data/no-such-file.jpg" }, 42 ];
+
+            cloudcv.processBatch('integralImage', items, { "packed": true }, function(error, results) { 
+                console.log(inspect(results));
+                assert.equal(error, null);
+                assert.equal(results[0].error, null);
+                assert.ok(results[1].error instanceof Error);
+                assert.ok(results[2].error instanceof Error);
+                done();
+            });
+        });
+
+    });
+});
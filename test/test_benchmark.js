@@ -0,0 +1,68 @@
+/**********************************************************************************
+ * CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+ *                    This project lets you to quickly prototype a REST API
+ *                    in a Node.js for a image processing service written in C++. 
+ * 
+ * Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+ * 
+ * More information:
+ *  - https://cloudcv.io
+ *  - http://computer-vision-talks.com
+ * 
+ **********************************************************************************/
+
+var assert = require("assert")
+var fs     = require('fs');
+var inspect = require('util').inspect;
+
+var cloudcv = require("../cloudcv.js");
+
+
+describe('cv', function() {
+
+    describe('benchmark', function() {
+
+        it('runBenchmark', function(done) {
+            this.timeout(20000);
+
+            var options = { "sizes": [ { "width": 64, "height": 48 } ], "channels": [ 1, 3 ], "images": [ "test/data/opencv-small.png" ], "iterations": 2, "minTimeMs": 0, "warmup": 1 };
+
+            cloudcv.runBenchmark(options, function(error, json) {
+                assert.equal(error, null);
+
+                var report = JSON.parse(json);
+                console.log(inspect(report));
+
+                var algorithms = cloudcv.getAlgorithms();
+                assert.equal(report.results.length, algorithms.length * 3);
+
+                report.results.forEach(function(result) {
+                    assert.equal(result.error, undefined);
+                    assert.ok(result.iterations >= 2);
+                    assert.ok(result.minNs <= result.medianNs && result.medianNs <= result.maxNs);
+                    assert.ok(result.nsPerPixel > 0);
+                    assert.equal(typeof result.allocationsPerCall, "number");
+                });
+
+                done();
+            });
+        });
+
+        it('runBenchmark - unknown image', function(done) {
+            var options = { "algorithms": [ "houghLines" ], "sizes": [], "images": [ "test/data/missing.png" ] };
+
+            cloudcv.runBenchmark(options, function(error, json) {
+                assert.equal(error, null);
+
+                var report = JSON.parse(json);
+                assert.equal(report.results.length, 1);
+                assert.equal(report.results[0].error, "Cannot read image");
+                done();
+            });
+        });
+
+        it('runBenchmark - invalid channels', function() {
+            assert.throws(function() { cloudcv.runBenchmark({ "channels": [ 2 ] }, function() {}); }, RangeError);
+        });
+    });
+});
@@ -0,0 +1,65 @@
+/**********************************************************************************
+ * CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+ *                    This project lets you to quickly prototype a REST API
+ *                    in a Node.js for a image processing service written in C++. 
+ * 
+ * Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+ * 
+ * More information:
+ *  - https://cloudcv.io
+ *  - http://computer-vision-talks.com
+ * 
+ **********************************************************************************/
+
+var assert = require("assert")
+var fs     = require('fs');
+var inspect = require('util').inspect;
+
+var cloudcv = require("../cloudcv.js");
+
+describe('cv', function() {
+
+    describe('cancellation', function() {
+
+        it('cancelled token', function(done) {
+            var imageData = fs.readFileSync("test/data/opencv-logo.jpg");
+            var token = new cloudcv.CancellationToken();
+            token.cancel();
+            assert.ok(token.cancelled);
+
+            cloudcv.houghLines({ "image": imageData }, { cancel: token }, function(error, result) { 
+                console.log(inspect(error));
+                assert.equal(error.code, 'ECANCELED');
+                assert.equal(result, null);
+                done();
+            });
+        });
+
+        it('deadline in the past', function(done) {
+            var imageData = fs.readFileSync("test/data/opencv-logo.jpg");
+
+            cloudcv.houghLines({ "image": imageData }, { deadline: Date.now() - 1000 }, function(error, result) { 
+                console.log(inspect(error));
+                assert.equal(error.code, 'ETIMEDOUT');
+                done();
+            });
+        });
+
+        it('generous timeout', function(done) {
+            var imageData = fs.readFileSync("test/data/opencv-logo.jpg");
+
+            cloudcv.houghLines({ "image": imageData }, { timeout: 60000, cancel: new cloudcv.CancellationToken() }, function(error, result) { 
+                assert.equal(error, null);
+                assert.notEqual(result.lines, null);
+                done();
+            });
+        });
+
+        it('invalid token', function() {
+            assert.throws(function() {
+                cloudcv.houghLines({ "image": "test/data/opencv-logo.jpg" }, { cancel: {} }, function() {});
+            }, TypeError);
+        });
+
+    });
+});
@@ -0,0 +1,83 @@
+/**********************************************************************************
+ * CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+ *                    This project lets you to quickly prototype a REST API
+ *                    in a Node.js for a image processing service written in C++. 
+ * 
+ * Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+ * 
+ * More information:
+ *  - https://cloudcv.io
+ *  - http://computer-vision-talks.com
+ * 
+ **********************************************************************************/
+
+var assert = require("assert")
+var fs     = require('fs');
+var inspect = require('util').inspect;
+
+var cloudcv = require("../cloudcv.js");
+
+describe('cv', function() {
+
+    describe('coalescing', function() {
+
+        it('identical requests run once', function(done) {
+            var imageData = fs.readFileSync("test/data/opencv-logo.jpg");
+            var total = 5, completed = 0;
+            var before = cloudcv.getQueueStats().completed;
+            var results = [];
+
+            for (var i = 0; i < total; i++) {
+                cloudcv.houghLines({ "image": imageData, "threshold": 50 }, function(error, result) { 
+                    assert.equal(error, null);
+                    results.push(result);
+
+                    if (++completed == total) {
+                        assert.equal(cloudcv.getQueueStats().completed - before, 1);
+                        results.forEach(function(r) {
+                            assert.deepEqual(r.lines, results[0].lines);
+                        });
+                        done();
+                    }
+                });
+            }
+        });
+
+        it('cancelling one caller does not stop the others', function(done) {
+            var imageData = fs.readFileSync("test/data/opencv-logo.jpg");
+            var token = new cloudcv.CancellationToken();
+            var completed = 0;
+
+            cloudcv.houghLines({ "image": imageData, "threshold": 60 }, { "cancel": token }, function(error, result) { 
+                assert.equal(error.code, 'ECANCELED');
+                if (++completed == 2) done();
+            });
+
+            cloudcv.houghLines({ "image": imageData, "threshold": 60 }, function(error, result) { 
+                assert.equal(error, null);
+                assert.notEqual(result.lines, null);
+                if (++completed == 2) done();
+            });
+
+            token.cancel();
+        });
+
+        it('can be disabled', function(done) {
+            var imageData = fs.readFileSync("test/data/opencv-logo.jpg");
+            var total = 3, completed = 0;
+            var before = cloudcv.getQueueStats().completed;
+
+            for (var i = 0; i < total; i++) {
+                cloudcv.houghLines({ "image": imageData }, { "coalesce": false }, function(error, result) { 
+                    assert.equal(error, null);
+
+                    if (++completed == total) {
+                        assert.equal(cloudcv.getQueueStats().completed - before, total);
+                        done();
+                    }
+                });
+            }
+        });
+
+    });
+});
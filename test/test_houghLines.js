@@ -46,6 +46,48 @@ describe('cv', function() {
             });
         });       
 
+        it('process (Packed)', function(done) {
+            var imageData = fs.readFileSync("test/data/opencv-logo.jpg");
+
+            cloudcv.houghLines({ "image": imageData }, { "packed": true }, function(error, result) { 
+                assert.equal(error, null);
+
+                var lines = result.lines;
+                assert.ok(lines.data instanceof Float32Array);
+                assert.equal(lines.shape[1], 2);
+                assert.equal(lines.data.length, lines.shape[0] * lines.shape[1]);
+                done();
+            });
+        });       
+
+        it('process (Positional)', function(done) {
+            var imageData = fs.readFileSync("test/data/opencv-logo.jpg");
+            var info = cloudcv.getInfo('houghLines');
+            var args = [];
+
+            Object.keys(info.inputArguments).forEach(function(key) {
+                var arg = info.inputArguments[key];
+                if (arg.name == "image")
+                    args[arg.slot] = imageData;
+            });
+
+            cloudcv.houghLines(args, { "coalesce": false }, function(error, result) { 
+                assert.equal(error, null);
+                assert.notEqual(result.lines, null);
+                done();
+            });
+        });
+
+        it('shouldReturnError (Too many positional arguments)', function(done) {
+            var imageData = fs.readFileSync("test/data/opencv-logo.jpg");
+
+            cloudcv.houghLines([imageData, 1, 1, 10, 1], function(error, result) { 
+                assert.notEqual(error, null);
+                assert.equal(result, null);
+                done();
+            });
+        });
+
         it('shouldReturnError (Missing argument)', function(done) {
 
             cloudcv.houghLines({}, function(error, result) { 
@@ -0,0 +1,55 @@
+/**********************************************************************************
+ * CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+ *                    This project lets you to quickly prototype a REST API
+ *                    in a Node.js for a image processing service written in C++. 
+ * 
+ * Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+ * 
+ * More information:
+ *  - https://cloudcv.io
+ *  - http://computer-vision-talks.com
+ * 
+ **********************************************************************************/
+
+var assert = require("assert")
+var fs     = require('fs');
+var inspect = require('util').inspect;
+
+var cloudcv = require("../cloudcv.js");
+
+describe('cv', function() {
+
+    describe('imageCache', function() {
+
+        it('reuses decoded image', function(done) {
+            var imageData = fs.readFileSync("test/data/opencv-logo.jpg");
+
+            cloudcv.clearImageCache();
+            var before = cloudcv.getImageCacheStats();
+
+            cloudcv.integralImage({ "image": imageData }, function(error, result) { 
+                assert.equal(error, null);
+
+                cloudcv.integralImage({ "image": imageData }, function(error, result) { 
+                    assert.equal(error, null);
+
+                    var after = cloudcv.getImageCacheStats();
+                    console.log(inspect(after));
+                    assert.equal(after.hits - before.hits, 1);
+                    assert.equal(after.entries, 1);
+                    done();
+                });
+            });
+        });
+
+        it('can be disabled', function(done) {
+            cloudcv.setImageCacheBudget(0);
+            assert.equal(cloudcv.getImageCacheStats().entries, 0);
+            assert.equal(cloudcv.getImageCacheStats().budget, 0);
+
+            cloudcv.setImageCacheBudget(64 * 1024 * 1024);
+            done();
+        });
+
+    });
+});
@@ -42,6 +42,21 @@ describe('cv', function() {
             });
         });       
 
+        it('returns Int32Array', function(done) {
+            var imageData = fs.readFileSync("test/data/opencv-small.png");
+
+            cloudcv.integralImage({ "image": imageData }, function(error, result) { 
+                assert.equal(error, null);
+
+                var integral = result.integralImage;
+                assert.ok(integral.data instanceof Int32Array);
+                assert.equal(integral.rows, 48 + 1);
+                assert.equal(integral.cols, 39 + 1);
+                assert.equal(integral.data.length, integral.rows * integral.cols);
+                done();
+            });
+        });
+
 
     });
 });
@@ -0,0 +1,55 @@
+/**********************************************************************************
+ * CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+ *                    This project lets you to quickly prototype a REST API
+ *                    in a Node.js for a image processing service written in C++. 
+ * 
+ * Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+ * 
+ * More information:
+ *  - https://cloudcv.io
+ *  - http://computer-vision-talks.com
+ * 
+ **********************************************************************************/
+
+var assert = require("assert")
+var fs     = require('fs');
+var inspect = require('util').inspect;
+
+var cloudcv = require("../cloudcv.js");
+
+describe('cv', function() {
+
+    describe('matAllocator', function() {
+
+        it('reuses buffers', function(done) {
+            var imageData = fs.readFileSync("test/data/opencv-logo.jpg");
+
+            cloudcv.setImageCacheBudget(0);
+            cloudcv.integralImage({ "image": imageData }, function(error, result) { 
+                assert.equal(error, null);
+                result = null;
+
+                cloudcv.integralImage({ "image": imageData }, function(error, result) { 
+                    assert.equal(error, null);
+
+                    var stats = cloudcv.getMatAllocatorStats();
+                    console.log(inspect(stats));
+                    assert.ok(stats.bytesInUse > 0);
+                    assert.ok(stats.hits + stats.misses > 0);
+
+                    cloudcv.setImageCacheBudget(64 * 1024 * 1024);
+                    done();
+                });
+            });
+        });
+
+        it('limit', function(done) {
+            cloudcv.setMatAllocatorLimit(0);
+            assert.equal(cloudcv.getMatAllocatorStats().maxPooledBytes, 0);
+
+            cloudcv.setMatAllocatorLimit(256 * 1024 * 1024);
+            done();
+        });
+
+    });
+});
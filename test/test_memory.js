@@ -0,0 +1,57 @@
+/**********************************************************************************
+ * CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+ *                    This project lets you to quickly prototype a REST API
+ *                    in a Node.js for a image processing service written in C++. 
+ * 
+ * Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+ * 
+ * More information:
+ *  - https://cloudcv.io
+ *  - http://computer-vision-talks.com
+ * 
+ **********************************************************************************/
+
+var assert = require("assert")
+var fs     = require('fs');
+var inspect = require('util').inspect;
+
+var cloudcv = require("../cloudcv.js");
+
+
+describe('cv', function() {
+
+    describe('nativeMemory', function() {
+
+        it('getMemoryStats', function(done) {
+            var imageData = fs.readFileSync("test/data/opencv-logo.jpg");
+
+            cloudcv.houghLines({ "image": imageData }, { "coalesce": false }, function(error, result) { 
+                assert.equal(error, null);
+
+                var stats = cloudcv.getMemoryStats();
+                console.log(inspect(stats));
+
+                assert.ok(stats.peakBytesInUse >= stats.bytesInUse);
+                assert.ok(stats.peakJobBytes > 0);
+                assert.ok(stats.externalBytes > 0);
+                done();
+            });
+        });
+
+        it('rejects jobs larger than per-job limit', function(done) {
+            var imageData = fs.readFileSync("test/data/opencv-logo.jpg");
+            var defaults = cloudcv.configureThreadPool({});
+
+            cloudcv.configureThreadPool({ maxJobBytes: 1024 });
+
+            cloudcv.houghLines({ "image": imageData }, { "coalesce": false }, function(error, result) { 
+                cloudcv.configureThreadPool({ maxJobBytes: defaults.maxJobBytes });
+
+                assert.notEqual(error, null);
+                assert.equal(error.code, 'ETOOLARGE');
+                assert.equal(result, null);
+                done();
+            });
+        });
+    });
+});
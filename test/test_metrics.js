@@ -0,0 +1,60 @@
+/**********************************************************************************
+ * CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+ *                    This project lets you to quickly prototype a REST API
+ *                    in a Node.js for a image processing service written in C++. 
+ * 
+ * Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+ * 
+ * More information:
+ *  - https://cloudcv.io
+ *  - http://computer-vision-talks.com
+ * 
+ **********************************************************************************/
+
+var assert = require("assert")
+var fs     = require('fs');
+var inspect = require('util').inspect;
+
+var cloudcv = require("../cloudcv.js");
+
+
+describe('cv', function() {
+
+    describe('metrics', function() {
+
+        it('getMetrics', function(done) {
+            var imageData = fs.readFileSync("test/data/opencv-logo.jpg");
+
+            cloudcv.houghLines({ "image": imageData }, { "coalesce": false }, function(error, result) { 
+                assert.equal(error, null);
+
+                var text = cloudcv.getMetrics();
+                console.log(text);
+
+                assert.ok(/^cloudcv_queue_depth \d+$/m.test(text));
+                assert.ok(/^cloudcv_jobs_in_flight \d+$/m.test(text));
+                assert.ok(/^cloudcv_algorithm_calls_total\{algorithm="houghLines"\} [1-9]\d*$/m.test(text));
+                assert.ok(/^cloudcv_algorithm_execution_seconds_bucket\{algorithm="houghLines",le="\+Inf"\} [1-9]\d*$/m.test(text));
+                assert.ok(/^cloudcv_stage_seconds_count\{stage="decode"\} [1-9]\d*$/m.test(text));
+                assert.ok(/^cloudcv_native_bytes \d+$/m.test(text));
+                done();
+            });
+        });
+
+        it('getMetrics - buckets are cumulative', function() {
+            var text = cloudcv.getMetrics();
+            var previous = 0;
+
+            text.split('\n').forEach(function(line) {
+                var match = /^cloudcv_algorithm_execution_seconds_bucket\{algorithm="houghLines",le="([^"]+)"\} (\d+)$/.exec(line);
+                if (!match)
+                    return;
+
+                assert.ok(Number(match[2]) >= previous);
+                previous = Number(match[2]);
+            });
+
+            assert.ok(previous > 0);
+        });
+    });
+});
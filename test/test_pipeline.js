@@ -0,0 +1,76 @@
+/**********************************************************************************
+ * CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+ *                    This project lets you to quickly prototype a REST API
+ *                    in a Node.js for a image processing service written in C++. 
+ * 
+ * Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+ * 
+ * More information:
+ *  - https://cloudcv.io
+ *  - http://computer-vision-talks.com
+ * 
+ **********************************************************************************/
+
+var assert = require("assert")
+var fs     = require('fs');
+var inspect = require('util').inspect;
+
+var cloudcv = require("../cloudcv.js");
+
+describe('cv', function() {
+
+    describe('processPipeline', function() {
+
+        it('shared input', function(done) {
+            var spec = {
+                inputs: { image: fs.readFileSync("test/data/opencv-logo.jpg") },
+                steps: [
+                    { name: "integral", algorithm: "integralImage", inputs: { image: { $ref: "image" } } },
+                    { name: "lines",    algorithm: "houghLines",    inputs: { image: { $ref: "image" }, threshold: 100 } }
+                ],
+                outputs: [ "integral.integralImage", "lines.lines" ]
+            };
+
+            cloudcv.processPipeline(spec, function(error, result) { 
+                assert.equal(error, null);
+                assert.notEqual(result.integral.integralImage, null);
+                assert.notEqual(result.lines.lines, null);
+                done();
+            });
+        });
+
+        it('rejects mismatched wiring', function(done) {
+            var spec = {
+                inputs: { image: "test/data/opencv-logo.jpg" },
+                steps: [
+                    { name: "lines",    algorithm: "houghLines",    inputs: { image: { $ref: "image" } } },
+                    { name: "integral", algorithm: "integralImage", inputs: { image: { $ref: "lines.lines" } } }
+                ],
+                outputs: [ "integral.integralImage" ]
+            };
+
+            cloudcv.processPipeline(spec, function(error, result) { 
+                console.log(inspect(error));
+                assert.ok(error instanceof Error);
+                done();
+            });
+        });
+
+        it('rejects forward references', function(done) {
+            var spec = {
+                steps: [
+                    { name: "lines",    algorithm: "houghLines",    inputs: { image: { $ref: "integral.integralImage" } } },
+                    { name: "integral", algorithm: "integralImage", inputs: { image: "test/data/opencv-logo.jpg" } }
+                ],
+                outputs: [ "lines.lines" ]
+            };
+
+            cloudcv.processPipeline(spec, function(error, result) { 
+                assert.ok(error instanceof Error);
+                assert.equal(result, null);
+                done();
+            });
+        });
+
+    });
+});
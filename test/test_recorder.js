@@ -0,0 +1,94 @@
+/**********************************************************************************
+ * CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+ *                    This project lets you to quickly prototype a REST API
+ *                    in a Node.js for a image processing service written in C++. 
+ * 
+ * Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+ * 
+ * More information:
+ *  - https://cloudcv.io
+ *  - http://computer-vision-talks.com
+ * 
+ **********************************************************************************/
+
+var assert = require("assert")
+var fs     = require('fs');
+var os     = require('os');
+var path   = require('path');
+var inspect = require('util').inspect;
+
+var cloudcv = require("../cloudcv.js");
+var trafficLog = require("../bench/trafficLog.js");
+
+describe('cv', function() {
+
+    describe('trafficRecorder', function() {
+
+        var logPath = path.join(os.tmpdir(), 'cloudcv-traffic-' + process.pid + '.log');
+
+        after(function() {
+            if (fs.existsSync(logPath))
+                fs.unlinkSync(logPath);
+        });
+
+        it('startRecording', function(done) {
+            var imageData = fs.readFileSync("test/data/opencv-logo.jpg");
+
+            cloudcv.startRecording(logPath, { "imageSampleRate": 1 });
+
+            cloudcv.houghLines({ "image": imageData, "threshold": 50 }, { "coalesce": false }, function(error, result) { 
+                assert.equal(error, null);
+
+                cloudcv.houghLines({ "image": imageData }, { "coalesce": false }, function(error, result) { 
+                    assert.equal(error, null);
+
+                    var stats = cloudcv.stopRecording();
+                    console.log(inspect(stats));
+
+                    assert.equal(stats.recording, false);
+                    assert.equal(stats.requests, 2);
+                    assert.equal(stats.imagesStored, 1);
+                    assert.equal(stats.dropped, 0);
+
+                    var log = trafficLog.read(logPath);
+                    assert.equal(log.requests.length, 2);
+                    assert.equal(log.requests[0].algorithm, "houghLines");
+                    assert.equal(log.requests[0].args.threshold, 50);
+                    assert.equal(log.requests[0].args.image.length, imageData.length);
+                    assert.equal(log.requests[0].args.image.hash, log.requests[1].args.image.hash);
+                    assert.ok(log.requests[1].time >= log.requests[0].time);
+
+                    // Bytes of the image are stored once, bound defaults are recorded too
+                    assert.equal(Object.keys(log.images).length, 1);
+                    assert.ok(log.images[log.requests[0].args.image.hash].equals(imageData));
+                    assert.equal(typeof log.requests[1].args.threshold, "number");
+                    done();
+                });
+            });
+        });
+
+        it('startRecording - images are not sampled', function(done) {
+            var imageData = fs.readFileSync("test/data/opencv-logo.jpg");
+
+            cloudcv.startRecording(logPath, { "imageSampleRate": 0 });
+
+            cloudcv.houghLines({ "image": imageData }, { "coalesce": false }, function(error, result) { 
+                assert.equal(error, null);
+
+                var stats = cloudcv.stopRecording();
+                assert.equal(stats.requests, 1);
+                assert.equal(stats.imagesStored, 0);
+
+                var log = trafficLog.read(logPath);
+                assert.equal(Object.keys(log.images).length, 0);
+                assert.equal(log.requests[0].args.image.length, imageData.length);
+                done();
+            });
+        });
+
+        it('startRecording - invalid path', function() {
+            assert.throws(function() { cloudcv.startRecording("/nonexistent/dir/traffic.log"); });
+            assert.equal(cloudcv.getRecorderStats().recording, false);
+        });
+    });
+});
@@ -0,0 +1,68 @@
+/**********************************************************************************
+ * CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+ *                    This project lets you to quickly prototype a REST API
+ *                    in a Node.js for a image processing service written in C++. 
+ * 
+ * Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+ * 
+ * More information:
+ *  - https://cloudcv.io
+ *  - http://computer-vision-talks.com
+ * 
+ **********************************************************************************/
+
+var assert = require("assert")
+var fs     = require('fs');
+var inspect = require('util').inspect;
+
+var cloudcv = require("../cloudcv.js");
+
+describe('cv', function() {
+
+    describe('stats', function() {
+
+        it('getStats', function(done) {
+            var stats = cloudcv.getStats();
+            console.log(inspect(stats, { depth: null }));
+
+            cloudcv.getAlgorithms().forEach(function(name) {
+                assert.notEqual(stats[name], undefined);
+                assert.equal(typeof stats[name].calls, 'number');
+                assert.equal(typeof stats[name].executionTime.p99, 'number');
+            });
+            done();
+        });
+
+        it('records calls', function(done) {
+            var imageData = fs.readFileSync("test/data/opencv-logo.jpg");
+            cloudcv.resetStats();
+
+            cloudcv.houghLines({ "image": imageData }, { "coalesce": false }, function(error, result) { 
+                assert.equal(error, null);
+
+                cloudcv.houghLines({}, function(error, result) { 
+                    assert.notEqual(error, null);
+
+                    var stats = cloudcv.getStats().houghLines;
+                    assert.equal(stats.calls, 1);
+                    assert.equal(stats.errors, 0);
+                    assert.ok(stats.bytesIn > 0);
+                    assert.equal(typeof stats.bytesOut, 'number');
+                    assert.equal(stats.executionTime.count, 1);
+                    assert.ok(stats.executionTime.max >= stats.executionTime.min);
+                    assert.ok(stats.queueTime.p50 >= 0);
+                    done();
+                });
+            });
+        });
+
+        it('resetStats', function(done) {
+            cloudcv.resetStats();
+
+            var stats = cloudcv.getStats().houghLines;
+            assert.equal(stats.calls, 0);
+            assert.equal(stats.executionTime.count, 0);
+            done();
+        });
+    });
+});
@@ -0,0 +1,65 @@
+/**********************************************************************************
+ * CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+ *                    This project lets you to quickly prototype a REST API
+ *                    in a Node.js for a image processing service written in C++. 
+ * 
+ * Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+ * 
+ * More information:
+ *  - https://cloudcv.io
+ *  - http://computer-vision-talks.com
+ * 
+ **********************************************************************************/
+
+var assert = require("assert")
+var fs     = require('fs');
+var inspect = require('util').inspect;
+
+var cloudcv = require("../cloudcv.js");
+
+describe('cv', function() {
+
+    describe('threadPool', function() {
+
+        it('configure', function(done) {
+            var options = cloudcv.configureThreadPool({ threads: 2, name: "cloudcv-test" });
+            console.log(inspect(options));
+            assert.equal(options.threads, 2);
+            assert.equal(options.name, "cloudcv-test");
+            done();
+        });
+
+        it('rejects invalid options', function(done) {
+            assert.throws(function() { cloudcv.configureThreadPool({ threads: -1 }); }, RangeError);
+            assert.throws(function() { cloudcv.configureThreadPool({ maxQueueDepth: 1.5 }); }, RangeError);
+            assert.throws(function() { cloudcv.configureThreadPool({ stackSize: "1M" }); }, TypeError);
+            assert.throws(function() { cloudcv.configureThreadPool({ stackSize: 16 }); }, Error);
+            assert.equal(cloudcv.configureThreadPool({}).threads, 2);
+            done();
+        });
+
+        it('rejects jobs when queue is full', function(done) {
+            var imageData = fs.readFileSync("test/data/opencv-logo.jpg");
+            var total = 20, completed = 0, rejected = 0;
+
+            cloudcv.configureThreadPool({ maxQueueDepth: 1 });
+
+            // Identical requests would be coalesced into one job otherwise
+            for (var i = 0; i < total; i++) {
+                cloudcv.houghLines({ "image": imageData }, { "coalesce": false }, function(error, result) { 
+                    if (error && error.code === 'EQUEUEFULL')
+                        rejected++;
+
+                    if (++completed == total) {
+                        console.log(inspect(cloudcv.getQueueStats()));
+                        assert.ok(rejected > 0);
+
+                        cloudcv.configureThreadPool({ threads: 0, name: "cloudcv", maxQueueDepth: 256 });
+                        done();
+                    }
+                });
+            }
+        });
+
+    });
+});
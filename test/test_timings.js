@@ -0,0 +1,60 @@
+/**********************************************************************************
+ * CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+ *                    This project lets you to quickly prototype a REST API
+ *                    in a Node.js for a image processing service written in C++. 
+ * 
+ * Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+ * 
+ * More information:
+ *  - https://cloudcv.io
+ *  - http://computer-vision-talks.com
+ * 
+ **********************************************************************************/
+
+var assert = require("assert")
+var fs     = require('fs');
+var inspect = require('util').inspect;
+
+var cloudcv = require("../cloudcv.js");
+
+
+describe('cv', function() {
+
+    describe('timings', function() {
+
+        it('process (Timings)', function(done) {
+            var imageData = fs.readFileSync("test/data/opencv-logo.jpg");
+
+            cloudcv.houghLines({ "image": imageData }, { "timings": true, "coalesce": false }, function(error, result, timings) { 
+                assert.equal(error, null);
+                console.log(inspect(timings));
+
+                ['bind', 'queue', 'decode', 'convert', 'kernel', 'marshal'].forEach(function(stage) {
+                    assert.equal(typeof timings[stage], 'number');
+                    assert.ok(timings[stage] >= 0);
+                });
+
+                assert.ok(timings.total >= timings.kernel + timings.decode);
+                done();
+            });
+        });
+
+        it('process (Timings on error)', function(done) {
+            cloudcv.houghLines({ "image": "test/data/missing.jpg" }, { "timings": true }, function(error, result, timings) { 
+                assert.notEqual(error, null);
+                assert.equal(typeof timings.queue, 'number');
+                done();
+            });
+        });
+
+        it('process (No timings by default)', function(done) {
+            var imageData = fs.readFileSync("test/data/opencv-logo.jpg");
+
+            cloudcv.houghLines({ "image": imageData }, function(error, result, timings) { 
+                assert.equal(error, null);
+                assert.equal(timings, undefined);
+                done();
+            });
+        });
+    });
+});
@@ -0,0 +1,69 @@
+/**********************************************************************************
+ * CloudCV Boostrap - A starter template for Node.js with OpenCV bindings.
+ *                    This project lets you to quickly prototype a REST API
+ *                    in a Node.js for a image processing service written in C++. 
+ * 
+ * Author: Eugene Khvedchenya <ekhvedchenya@gmail.com>
+ * 
+ * More information:
+ *  - https://cloudcv.io
+ *  - http://computer-vision-talks.com
+ * 
+ **********************************************************************************/
+
+var assert = require("assert")
+var fs     = require('fs');
+var inspect = require('util').inspect;
+
+var cloudcv = require("../cloudcv.js");
+
+
+describe('cv', function() {
+
+    describe('tracing', function() {
+
+        it('dumpTrace', function(done) {
+            var imageData = fs.readFileSync("test/data/opencv-logo.jpg");
+            cloudcv.startTracing();
+
+            cloudcv.houghLines({ "image": imageData }, { "coalesce": false }, function(error, result) { 
+                assert.equal(error, null);
+                cloudcv.stopTracing();
+
+                var trace = JSON.parse(cloudcv.dumpTrace());
+                assert.ok(Array.isArray(trace.traceEvents));
+                assert.ok(trace.traceEvents.length > 0);
+
+                var scopes = trace.traceEvents.filter(function(event) { return event.ph == 'X'; });
+                assert.ok(scopes.length > 0);
+                scopes.forEach(function(event) {
+                    assert.equal(typeof event.ts, 'number');
+                    assert.ok(event.dur >= 0);
+                });
+                done();
+            });
+        });
+
+        it('records nothing when stopped', function(done) {
+            var imageData = fs.readFileSync("test/data/opencv-logo.jpg");
+            cloudcv.startTracing();
+            cloudcv.stopTracing();
+
+            cloudcv.houghLines({ "image": imageData }, { "coalesce": false }, function(error, result) { 
+                assert.equal(error, null);
+
+                var trace = JSON.parse(cloudcv.dumpTrace());
+                assert.equal(trace.traceEvents.length, 0);
+                done();
+            });
+        });
+
+        it('captureTrace', function(done) {
+            cloudcv.captureTrace(50, function(error, trace) {
+                assert.equal(error, null);
+                assert.ok(Array.isArray(JSON.parse(trace).traceEvents));
+                done();
+            });
+        });
+    });
+});